@@ -96,6 +96,7 @@ extern          "C" {
 #define VCONF_ERROR             -1
 #define VCONF_ERROR_FILE_NO_ENT -ENOENT
 #define VCONF_ERROR_FILE_PERM   -EPERM
+#define VCONF_ERROR_TIMEOUT     -ETIMEDOUT
 
 /**
  * @brief Enumeration for uses of vconf_get().
@@ -146,6 +147,55 @@ typedef enum get_option_t get_option_t;
 		   /**< Vconf directory type */
     };
 
+/**
+ * @brief Enumeration of the statistics returned by vconf_get_stat().
+ *
+ * @see vconf_get_stat()
+ */
+    enum vconf_stat_t {
+	VCONF_STAT_CACHE_HITS = 0,
+		   /**< count of reads answered by the cache */
+	VCONF_STAT_CACHE_MISSES,
+		   /**< count of reads not answered by the cache */
+	VCONF_STAT_RECONNECTS,
+		   /**< count of connections to buxton after the first one */
+	VCONF_STAT_KEYS_CREATED,
+		   /**< count of buxton keys created */
+	VCONF_STAT_REQUESTS,
+		   /**< count of requests sent for keylists */
+	VCONF_STAT_POLLS,
+		   /**< count of polls waiting for responses of buxton */
+	VCONF_STAT_WAKEUPS,
+		   /**< count of dispatches having handled responses */
+	VCONF_STAT_RESPONSES
+		   /**< count of responses handled by the dispatches, divided
+		    * by VCONF_STAT_WAKEUPS it gives the responses per wakeup */
+    };
+
+/**
+ * @brief  Enumeration type of the statistics.
+ */
+typedef enum vconf_stat_t vconf_stat_t;
+
+/**
+ * @brief Enumeration of the policies for closing the connection to buxton.
+ *
+ * @see vconf_set_connection_policy()
+ */
+    enum vconf_connection_policy_t {
+	VCONF_CONNECTION_CLOSE = 0,
+		   /**< close the connection as soon as it is unused (default) */
+	VCONF_CONNECTION_KEEP,
+		   /**< keep the connection opened */
+	VCONF_CONNECTION_IDLE
+		   /**< close the connection after an idle period */
+    };
+
+/**
+ * @brief  Enumeration type of the connection policies.
+ */
+typedef enum vconf_connection_policy_t vconf_connection_policy_t;
+
 
 /**
  * @brief The structure type for an opaque type. It must be used via accessor functions.
@@ -178,6 +228,77 @@ typedef enum get_option_t get_option_t;
  */
     typedef struct _keylist_t keylist_t;
 
+/**
+ * @brief The structure type for an opaque prepared key.
+ *
+ * @see vconf_key_open()
+ * @see vconf_key_close()
+ */
+    typedef struct _vconf_key_t vconf_key_t;
+
+/**
+ * @brief The structure type for an opaque context.
+ *
+ * @see vconf_ctx_new()
+ * @see vconf_ctx_free()
+ */
+    typedef struct _vconf_ctx_t vconf_ctx_t;
+
+/**
+ * @brief The glib main context, declared here to not include glib.
+ *
+ * @see vconf_set_main_context()
+ */
+    struct _GMainContext;
+
+/**
+ * @brief The structure type for describing one key of vconf_get_many()
+ * and vconf_set_many().
+ * @details The field 'value' points to the variable of the value: an int
+ * for #VCONF_TYPE_INT and #VCONF_TYPE_BOOL, a double for
+ * #VCONF_TYPE_DOUBLE and a char* for #VCONF_TYPE_STRING.
+ *
+ * @see vconf_get_many()
+ * @see vconf_set_many()
+ */
+    typedef struct {
+	const char *keyname;
+		   /**< name of the key */
+	int type;
+		   /**< type of the value (a value of enum vconf_t) */
+	void *value;
+		   /**< address of the variable of the value */
+	int status;
+		   /**< returned status of the key: 0 on success, -1 on error */
+    } vconf_desc_t;
+
+/**
+ * @brief The structure type for the options of
+ * vconf_notify_key_changed_full().
+ * @details The delays are in milliseconds, 0 disables them. With a
+ * debounce delay, the callback is called once the key stayed unchanged
+ * during that delay. With a minimum interval, the changes coming too
+ * early are delayed and only the latest one is delivered. With
+ * latest_only, the changes received together are collapsed to the last.
+ * With thread_context, the callback is run by the thread-default main
+ * context of the registering thread (see
+ * g_main_context_push_thread_default()) instead of the main context set
+ * by vconf_set_main_context().
+ *
+ * @see vconf_notify_key_changed_full()
+ */
+    typedef struct {
+	unsigned min_interval;
+		   /**< minimum delay between two calls of the callback */
+	unsigned debounce;
+		   /**< delay without change before calling the callback */
+	int latest_only;
+		   /**< if not 0, skip the changes followed by another one */
+	int thread_context;
+		   /**< if not 0, run the callback in the thread-default main
+		    * context of the registering thread */
+    } vconf_notify_options_t;
+
 
 /**
  * @brief  Called when the key is set handle.
@@ -189,6 +310,27 @@ typedef enum get_option_t get_option_t;
  */
     typedef void (*vconf_callback_fn) (keynode_t *node, void *user_data);
 
+/**
+ * @brief  Called when an asynchronous call on a keylist is completed.
+ * @details  The status is 0 on success or -1 on error. The keylist can
+ * be used again from the callback.
+ *
+ * @see vconf_get_async()
+ * @see vconf_set_async()
+ * @see vconf_refresh_async()
+ */
+    typedef void (*vconf_done_fn) (keylist_t *keylist, int status,
+				   void *user_data);
+
+/**
+ * @brief  Called with the keys changed together.
+ * @details  The keylist holds the latest value of each key changed since
+ * the previous call. It is freed when the callback returns.
+ *
+ * @see vconf_notify_batch_changed()
+ */
+    typedef void (*vconf_batch_fn) (keylist_t *keylist, void *user_data);
+
 /************************************************
  * keynode handling APIs                        *
  ************************************************/
@@ -339,6 +481,22 @@ typedef enum get_option_t get_option_t;
  */
     keylist_t *vconf_keylist_new(void);
 
+/**
+ * @brief Allocates, initializes and returns a new keylist object whose
+ * nodes, key names and string values are allocated in an arena.
+ * @details The arena is released at once by vconf_keylist_free(). Keys
+ * removed with vconf_keylist_del() and replaced string values are only
+ * reclaimed at that time. This suits lists built, used and freed in
+ * one go.
+ *
+ * @return  The pointer of New keylist,
+ *          otherwise @c NULL on error
+ *
+ * @see vconf_keylist_new()
+ * @see vconf_keylist_free()
+ */
+    keylist_t *vconf_keylist_new_arena(void);
+
 /**
  * @brief Moves the current keynode position to the first item.
  *
@@ -1097,6 +1255,79 @@ int main(int argc, char **argv)
  */
     int vconf_ignore_key_changed(const char *in_key, vconf_callback_fn cb);
 
+/**
+ * This function adds a change callback for the key like
+ * vconf_notify_key_changed() but with options limiting the rate of the
+ * calls. The skipped changes are lost, the callback always gets the
+ * latest value. The callback is removed by vconf_ignore_key_changed().
+ * @param[in]	in_key the key
+ * @param[in]	cb the callback
+ * @param[in]	user_data the data given to the callback
+ * @param[in]	options the options or NULL for none
+ * @return 0 on success, -1 on error
+ * @see vconf_notify_options_t
+ * @see vconf_ignore_key_changed()
+ */
+    int             vconf_notify_key_changed_full(const char *in_key,
+						  vconf_callback_fn cb,
+						  void *user_data,
+						  const vconf_notify_options_t
+						  *options);
+
+/**
+ * This function adds a change callback for all the keys of a directory
+ * and of its subdirectories. The existing keys are found with one scan
+ * and each key is registered once whatever the count of its callbacks.
+ * Buxton doesn't notify the creation of keys: the keys created later
+ * through vconf by this process are added when set, the others are
+ * added by calling this function again, which scans the directory again.
+ * Calling it with the same directory and callback but other data is an
+ * error. On error, none of the callbacks of the call is added.
+ * @param[in]	dirpath the directory
+ * @param[in]	cb the callback, called with the changed key
+ * @param[in]	user_data the data given to the callback
+ * @return 0 on success, -1 on error
+ * @see vconf_ignore_dir_changed()
+ */
+    int             vconf_notify_dir_changed(const char *dirpath,
+					     vconf_callback_fn cb,
+					     void *user_data);
+
+/**
+ * This function removes the change callback added for a directory by
+ * vconf_notify_dir_changed().
+ * @param[in]	dirpath the directory
+ * @param[in]	cb the callback
+ * @return 0 on success, -1 on error
+ * @see vconf_notify_dir_changed()
+ */
+    int             vconf_ignore_dir_changed(const char *dirpath,
+					     vconf_callback_fn cb);
+
+/**
+ * This function adds a callback receiving in one keylist the changes of
+ * the keys of 'keylist' delivered by one dispatch: one wakeup of the
+ * main context, one call of vconf_dispatch_pending() or of the
+ * dispatcher. Calling it again with the same callback and data adds keys;
+ * calling it with the same callback and other data is an error.
+ * @param[in]	keylist the keys to watch, only their names are used
+ * @param[in]	cb the callback
+ * @param[in]	user_data the data given to the callback
+ * @return 0 on success, -1 on error
+ * @see vconf_ignore_batch_changed()
+ */
+    int             vconf_notify_batch_changed(keylist_t *keylist,
+					       vconf_batch_fn cb,
+					       void *user_data);
+
+/**
+ * This function removes the callback added by vconf_notify_batch_changed().
+ * @param[in]	cb the callback
+ * @return 0 on success, -1 on error
+ * @see vconf_notify_batch_changed()
+ */
+    int             vconf_ignore_batch_changed(vconf_batch_fn cb);
+
 /**
  * This function sorts the list in alphabetical order (with LANG=C)
  * @param[in] keylist Key List
@@ -1198,6 +1429,7 @@ int main()
 
 /**
  * Set the default group of key lists created using vconf_keylist_new.
+ * The values cached by vconf_set_cache_capacity() are flushed.
  * @param[in] groupname The name of the default group to bind to
  * @return 0 in case of success or -1 in case of error of allocation
  * @see vconf_keylist_new()
@@ -1220,6 +1452,343 @@ int main()
  * @retval #VCONF_ERROR_FILE_PERM    Permission denied
  */
     int             vconf_get_ext_errno(void);
+
+/**
+ * This function prepares the key of name 'keyname'.
+ * The name, the layer, the group and the buxton keys are resolved once
+ * so that the functions vconf_key_get_* and vconf_key_set_* don't have
+ * to do it at each call. The group is the default group at the time of
+ * the call. The buxton key of a type is created at its first use and
+ * the value cached for the key is then reached without lookup.
+ * @param[in]	keyname the name of the key
+ * @return the prepared key on success, NULL on error
+ * @see vconf_key_close()
+ */
+    vconf_key_t    *vconf_key_open(const char *keyname);
+
+/**
+ * This function releases a key prepared by vconf_key_open.
+ * @param[in]	key the prepared key
+ * @return 0 on success, -1 on error
+ */
+    int             vconf_key_close(vconf_key_t *key);
+
+/**
+ * These functions get the value of a prepared key.
+ * They behave like vconf_get_int, vconf_get_bool, vconf_get_dbl and
+ * vconf_get_str.
+ * @param[in]	key the prepared key
+ * @param[out]	intval, boolval, dblval the output buffer
+ * @return 0 on success, -1 on error
+ *	(vconf_key_get_str returns the allocated value or NULL on error)
+ * @see vconf_key_open()
+ */
+    int             vconf_key_get_int(vconf_key_t *key, int *intval);
+    int             vconf_key_get_bool(vconf_key_t *key, int *boolval);
+    int             vconf_key_get_dbl(vconf_key_t *key, double *dblval);
+    char           *vconf_key_get_str(vconf_key_t *key);
+
+/**
+ * These functions set the value of a prepared key.
+ * They behave like vconf_set_int, vconf_set_bool, vconf_set_dbl and
+ * vconf_set_str.
+ * @param[in]	key the prepared key
+ * @param[in]	intval, boolval, dblval, strval the value to set
+ * @return 0 on success, -1 on error
+ * @see vconf_key_open()
+ */
+    int             vconf_key_set_int(vconf_key_t *key, const int intval);
+    int             vconf_key_set_bool(vconf_key_t *key, const int boolval);
+    int             vconf_key_set_dbl(vconf_key_t *key, const double dblval);
+    int             vconf_key_set_str(vconf_key_t *key, const char *strval);
+
+/**
+ * This function gets the values of 'count' keys in one pass.
+ * The requests for the keys not found in the cache are all sent before
+ * waiting for the responses. The status of each key is recorded in its
+ * descriptor. A key whose value doesn't have the expected type fails.
+ * The returned strings must be released using free.
+ * @param[in,out]	descs the descriptors of the keys
+ * @param[in]	count the count of descriptors
+ * @return 0 if all keys were read, -1 otherwise
+ * @see vconf_desc_t
+ */
+    int             vconf_get_many(vconf_desc_t *descs, unsigned count);
+
+/**
+ * This function sets the values of 'count' keys in one pass.
+ * The values are read from the variables pointed by the descriptors,
+ * no keylist is built. All the requests are sent before waiting for the
+ * responses. The status of each key is recorded in its descriptor.
+ * @param[in,out]	descs the descriptors of the keys
+ * @param[in]	count the count of descriptors
+ * @return 0 if all keys were set, -1 otherwise
+ * @see vconf_desc_t
+ */
+    int             vconf_set_many(vconf_desc_t *descs, unsigned count);
+
+/**
+ * This function sets the capacity of the cache of values.
+ * The cache is used by vconf_get_int, vconf_get_bool, vconf_get_dbl and
+ * vconf_get_str. It is kept up to date using the notifications of buxton,
+ * one notification being registered for each cached key. Like the change
+ * callbacks, these notifications are processed by the glib main loop, the
+ * dispatcher thread or vconf_dispatch_pending. Unless the dispatcher
+ * thread runs, a read answered by the cache also processes the
+ * notifications already received. When the cache is full, the values of the
+ * keys not already cached are read without being cached.
+ * Setting the capacity empties the cache.
+ * @param[in]	capacity the maximum count of cached keys, 0 (the default)
+ *		disables the cache
+ * @return 0 on success, -1 on error
+ * @see vconf_get_stat()
+ */
+    int             vconf_set_cache_capacity(unsigned capacity);
+
+/**
+ * This function sets the policy for closing the connection to buxton
+ * when no keylist, notification or cached value uses it.
+ * The idle period of VCONF_CONNECTION_IDLE is measured using the glib
+ * main loop. Without glib or main loop, the connection is kept.
+ * In any case, a broken connection is dropped and the next call reconnects,
+ * registering again the watched keys. A connection that can't be opened
+ * is tried again by the next call, whatever the policy.
+ * @param[in]	policy the policy to apply
+ * @param[in]	idle_period the idle period in milliseconds before closing
+ *		the connection when policy is VCONF_CONNECTION_IDLE
+ * @return 0 on success, -1 on error
+ * @see vconf_get_stat()
+ */
+    int             vconf_set_connection_policy(vconf_connection_policy_t policy,
+						unsigned idle_period);
+
+/**
+ * This function sets the maximum count of connections of the pool.
+ * The connections of the pool are private to one operation at a time
+ * so that threads getting or setting keys don't wait each other. The
+ * shared connection is used by the notifications, the cache, the scans
+ * and when all the connections of the pool are busy.
+ * @param[in]	size the maximum count of connections, 0 (the default)
+ *		disables the pool
+ * @return 0 on success, -1 on error
+ * @see vconf_set_connection_policy()
+ */
+    int             vconf_set_connection_pool(unsigned size);
+
+/**
+ * This function sets the default timeout of the calls waiting for buxton.
+ * The timeout bounds the whole call, not each wait. When it expires, the
+ * call returns VCONF_ERROR_TIMEOUT and gives up its pending requests,
+ * whose late responses are ignored. The shared connection stays open for
+ * the other calls and the notifications. The default is 5000 milliseconds.
+ * @param[in]	timeout the timeout in milliseconds, negative for none
+ * @return 0 on success, -1 on error
+ * @see vconf_get_timed()
+ * @see vconf_set_timed()
+ */
+    int             vconf_set_timeout(int timeout);
+
+/**
+ * These functions behave like vconf_get, vconf_refresh, vconf_scan,
+ * vconf_set, vconf_get_many and vconf_set_many but wait buxton at most
+ * 'timeout' milliseconds instead of the default timeout.
+ * @param[in]	timeout the timeout in milliseconds, negative for none
+ * @return 0 on success, VCONF_ERROR_TIMEOUT if the timeout expired,
+ *	-1 on other errors
+ * @see vconf_set_timeout()
+ */
+    int             vconf_get_timed(keylist_t *keylist, const char *in_parentDIR,
+				    get_option_t option, int timeout);
+    int             vconf_refresh_timed(keylist_t *keylist, int timeout);
+    int             vconf_scan_timed(keylist_t *keylist, const char *dirpath,
+				     get_option_t option, int timeout);
+    int             vconf_set_timed(keylist_t *keylist, int timeout);
+    int             vconf_get_many_timed(vconf_desc_t *descs, unsigned count,
+					 int timeout);
+    int             vconf_set_many_timed(vconf_desc_t *descs, unsigned count,
+					 int timeout);
+
+/**
+ * This function sets the maximum count of requests of a keylist that
+ * are waiting for their response. Up to that count, the requests are
+ * sent without waiting. The default is 64. The requests and responses
+ * of a full window must fit in the buffers of the socket.
+ * @param[in]	window the count of requests, at least 1
+ * @return 0 on success, -1 on error
+ * @see vconf_get_stat()
+ */
+    int             vconf_set_pipeline_window(unsigned window);
+
+/**
+ * This function sets the maximum count of responses of buxton handled
+ * by one wakeup of the glib source or by one call of
+ * vconf_dispatch_pending(). The responses left are handled by the next
+ * wakeup, letting the main loop run the other sources. The default is 64.
+ * @param[in]	budget the count of responses, at least 1
+ * @return 0 on success, -1 on error
+ * @see vconf_get_stat()
+ */
+    int             vconf_set_dispatch_budget(unsigned budget);
+
+/**
+ * This function sets the count of threads running the callbacks of
+ * vconf_notify_key_changed(). With 0 (the default), the callbacks are
+ * run by the thread handling the changes, usually the glib main loop.
+ * Otherwise, the callbacks are run by that many threads: the callbacks
+ * of a key are run in order, one at a time, but a slow callback doesn't
+ * delay the other keys. The pending callbacks are run before the threads
+ * stop. This function must not be called from a callback.
+ * @param[in]	count the count of threads, 0 to run the callbacks inline
+ * @return 0 on success, -1 on error
+ * @see vconf_notify_key_changed()
+ */
+    int             vconf_set_notify_workers(unsigned count);
+
+/**
+ * This function sets the glib main context watching the connection to
+ * buxton and running the callbacks of vconf_notify_key_changed(). NULL
+ * (the default) stands for the global default main context. The
+ * callbacks registered with the option thread_context of
+ * vconf_notify_key_changed_full() are run by the thread-default main
+ * context of their registering thread instead. When a main context is
+ * set, the changes received by the other threads are queued to it.
+ * @param[in]	context the main context (a GMainContext) or NULL
+ * @return 0 on success, -1 on error
+ * @see vconf_notify_key_changed()
+ */
+    int             vconf_set_main_context(struct _GMainContext *context);
+
+/**
+ * This function returns a file handle to watch for reading in order to
+ * receive the notifications without glib. The handle stays the same
+ * when the connection to buxton is renewed. When it is readable, call
+ * vconf_dispatch_pending(). While the connection is lost with watched
+ * keys, the handle becomes readable every second so that
+ * vconf_dispatch_pending() tries again to connect.
+ * @return the file handle on success, -1 on error
+ * @see vconf_get_events()
+ * @see vconf_dispatch_pending()
+ */
+    int             vconf_get_fd(void);
+
+/**
+ * This function returns the poll events to wait on the handle returned
+ * by vconf_get_fd(): POLLIN when connected to buxton, 0 otherwise.
+ * @return the poll events
+ * @see vconf_get_fd()
+ */
+    int             vconf_get_events(void);
+
+/**
+ * This function handles without waiting the messages received from
+ * buxton and runs the callbacks of the changed keys.
+ * @return the count of handled messages, -1 if the connection is lost
+ * @see vconf_get_fd()
+ */
+    int             vconf_dispatch_pending(void);
+
+/**
+ * This function starts a thread that waits the messages of buxton and
+ * runs the callbacks of the changed keys, for the processes running no
+ * main loop. Starting it again does nothing.
+ * @return 0 on success, -1 on error
+ * @see vconf_stop_dispatcher()
+ */
+    int             vconf_start_dispatcher(void);
+
+/**
+ * This function stops the thread started by vconf_start_dispatcher()
+ * and waits its end. It must not be called from a callback.
+ * @return 0 on success, -1 on error
+ * @see vconf_start_dispatcher()
+ */
+    int             vconf_stop_dispatcher(void);
+
+/**
+ * These functions behave like vconf_get, vconf_refresh and vconf_set but
+ * return without waiting buxton. The callback 'cb' is called with the
+ * status when the responses are received, through the glib source, the
+ * dispatcher or vconf_dispatch_pending(). The keylist must not be used
+ * nor freed until then. vconf_get_async() doesn't scan: it only refreshes
+ * the keys of the keylist.
+ * @param[in]	keylist the keylist
+ * @param[in]	cb the completion callback or NULL
+ * @param[in]	user_data the data given to the callback
+ * @return 0 if the call is started, -1 on error
+ * @see vconf_done_fn
+ */
+    int             vconf_get_async(keylist_t *keylist, const char *in_parentDIR,
+				    get_option_t option, vconf_done_fn cb,
+				    void *user_data);
+    int             vconf_refresh_async(keylist_t *keylist, vconf_done_fn cb,
+					void *user_data);
+    int             vconf_set_async(keylist_t *keylist, vconf_done_fn cb,
+				    void *user_data);
+
+/**
+ * This function creates a context. A context has its own connection to
+ * buxton, default group, error code and cache of values, so that it
+ * shares nothing with the other contexts and with the functions without
+ * context. It starts with the current default group and cache capacity.
+ * A context must be used by only one thread at a time.
+ * @return the created context or NULL on error
+ * @see vconf_ctx_free()
+ */
+    vconf_ctx_t    *vconf_ctx_new(void);
+
+/**
+ * This function closes the connection of a context and frees it.
+ * @param[in]	ctx the context to free
+ * @return 0 on success, -1 on error
+ * @see vconf_ctx_new()
+ */
+    int             vconf_ctx_free(vconf_ctx_t *ctx);
+
+/**
+ * These functions set the default group, set the cache capacity and get
+ * the last error code of a context. They behave like
+ * vconf_set_default_group, vconf_set_cache_capacity and
+ * vconf_get_ext_errno for the context only.
+ * @param[in]	ctx the context
+ * @see vconf_ctx_new()
+ */
+    int             vconf_ctx_set_default_group(vconf_ctx_t *ctx,
+						const char *groupname);
+    int             vconf_ctx_set_cache_capacity(vconf_ctx_t *ctx,
+						 unsigned capacity);
+    int             vconf_ctx_get_ext_errno(vconf_ctx_t *ctx);
+
+/**
+ * These functions behave like vconf_set, vconf_refresh, vconf_get_* and
+ * vconf_set_* using the connection, group and cache of a context.
+ * @param[in]	ctx the context
+ * @see vconf_ctx_new()
+ */
+    int             vconf_ctx_set(vconf_ctx_t *ctx, keylist_t *keylist);
+    int             vconf_ctx_refresh(vconf_ctx_t *ctx, keylist_t *keylist);
+    int             vconf_ctx_get_int(vconf_ctx_t *ctx, const char *keyname,
+				      int *intval);
+    int             vconf_ctx_get_bool(vconf_ctx_t *ctx, const char *keyname,
+				       int *boolval);
+    int             vconf_ctx_get_dbl(vconf_ctx_t *ctx, const char *keyname,
+				      double *dblval);
+    char           *vconf_ctx_get_str(vconf_ctx_t *ctx, const char *keyname);
+    int             vconf_ctx_set_int(vconf_ctx_t *ctx, const char *keyname,
+				      const int intval);
+    int             vconf_ctx_set_bool(vconf_ctx_t *ctx, const char *keyname,
+				       const int boolval);
+    int             vconf_ctx_set_dbl(vconf_ctx_t *ctx, const char *keyname,
+				      const double dblval);
+    int             vconf_ctx_set_str(vconf_ctx_t *ctx, const char *keyname,
+				      const char *strval);
+
+/**
+ * This function reads the value of a statistic counter.
+ * @param[in]	stat the statistic to read
+ * @param[out]	value the value of the counter
+ * @return 0 on success, -1 on error
+ */
+    int             vconf_get_stat(vconf_stat_t stat, unsigned long *value);
 /**
  * @}
  */
@@ -28,7 +28,8 @@
  *
  * NO_GLIB
  *     Defining NO_GLIB removes support of GLIB main loop used for notification
- *     Defining it implies to dig code to find some replacement (new API verbs to create).
+ *     Defining it implies to dispatch the notifications using vconf_get_fd()
+ *     and vconf_dispatch_pending().
  *
  * REMOVE_PREFIXES
  *     Removes the prefixe of the keys depending (depends on the layer).
@@ -46,12 +47,19 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
 #include <buxton.h>
 #if !defined(NO_GLIB)
 #include <glib.h>
 #endif
 #if !defined(NO_MULTITHREADING)
 #include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
 #endif
 
 #include "vconf-buxton.h"
@@ -92,10 +100,19 @@ struct _keynode_t
   enum keytype type;		/* type of the key */
   union keyvalue value;		/* value of the key */
   keynode_t *next;		/* linking to the next key */
+  keynode_t **prev;		/* address of the link to this key */
+  keynode_t *hnext;		/* linking to the next key of the index bucket */
+  unsigned hash;		/* hash of the name of the key */
+  int status;			/* status of the last operation on the key */
   keylist_t *list;		/* the containing list */
   const char *keyname;		/* name of the key */
 };
 
+/*
+ * status of a key whose request waits for its response 
+ */
+#define KEYNODE_PENDING 1
+
 /*
  * structure for list of keys 
  */
@@ -109,6 +126,14 @@ struct _keylist_t
   unsigned cb_sent;		/* callback global count of sent queries */
   unsigned cb_received;		/* callback global count of
 				 * received responses */
+  BuxtonClient cb_client;	/* client of the current operation */
+  int cb_shared;		/* is cb_client the shared client? */
+  vconf_ctx_t *cb_ctx;		/* context of the current operation or NULL */
+  struct async *cb_async;	/* asynchronous operation or NULL */
+  struct keycache **keys;	/* prepared buxton keys by type or NULL */
+  keynode_t **index;		/* hash index of the keys or NULL */
+  unsigned index_size;		/* count of buckets of the index */
+  struct arena_chunk *arena;	/* memory of arena lists or NULL */
 };
 
 /*
@@ -116,7 +141,8 @@ struct _keylist_t
  */
 struct scanning_data
 {
-  int pending;			/* is the scan pending? */
+  unsigned sent;		/* count of sent queries */
+  unsigned received;		/* count of received responses */
   int cb_status;		/* status of the call back */
   int want_directories;		/* is scanning directories? */
   int want_keys;		/* is scanning keys? */
@@ -153,13 +179,217 @@ struct singleton
  */
 struct notify
 {
-  int status;			/* callback status */
   vconf_callback_fn callback;	/* the user callback */
   void *userdata;		/* the user data */
-  keynode_t *keynode;		/* the recorded key node */
+  struct watch *watch;		/* the watch of the key */
+  struct prefix *prefix;	/* the directory watch or NULL */
+  struct batch *batch;		/* the batch subscription or NULL */
+#if !defined(NO_GLIB)
+  struct loop *loop;		/* the main context running the callback */
+#endif
+  int removed;			/* is it removed from its watch? */
+  unsigned min_interval;	/* minimum delay between two calls (ms) */
+  unsigned debounce;		/* delay without change before a call (ms) */
+  int latest_only;		/* skip the changes followed by another one? */
+  struct event *latest;		/* the latest change of the delivery pass */
+  struct event *held;		/* the change delayed or NULL */
+  unsigned long long due;	/* when to deliver the held change (ms) */
+  unsigned long long last;	/* when the last change was delivered (ms) */
+  struct notify *held_next;	/* link to the next notification holding */
   struct notify *next;		/* tink to the next notification */
 };
 
+/*
+ * structure for the changes waiting for their delivery
+ */
+struct event
+{
+  struct event *next;		/* link to the next event */
+  struct notify *notif;		/* the notification to deliver or NULL */
+  struct async *async;		/* the asynchronous operation to continue */
+  keynode_t node;		/* the changed key and its value */
+};
+
+/*
+ * structure for the asynchronous operations on keylists
+ */
+struct async
+{
+  struct async *next;		/* link to the next pending operation */
+  keylist_t *keylist;		/* the keylist of the operation */
+  int (*request) (keynode_t *, const char *);	/* sends the request of a key */
+  keynode_t *keynode;		/* the next key to send or NULL */
+  unsigned generation;		/* generation of the client */
+  int is_set;			/* does it set the keys? */
+  vconf_done_fn done;		/* the completion callback or NULL */
+  void *userdata;		/* the data of the callback */
+  struct event event;		/* the event continuing the operation */
+};
+
+/*
+ * structure for the arrays of notifications of a watched key. Once
+ * published, an array is never modified: it is replaced by a copy.
+ */
+struct notify_set
+{
+  struct notify_set *next;	/* link to the next retired array */
+  unsigned count;		/* count of notifications */
+  struct notify *items[];	/* the notifications */
+};
+
+/*
+ * structure for watched keys
+ */
+struct watch
+{
+  struct watch *next;		/* link to the next watch of the bucket */
+  unsigned hash;		/* hash of the key name */
+  struct notify_set *set;	/* the current notifications */
+  int registered;		/* is it registered to buxton? */
+  unsigned generation;		/* generation of the client registering it */
+  int status;			/* status of the registration */
+  struct event *pending;	/* events waiting for a worker */
+  struct event *pending_last;	/* the last event waiting */
+  struct watch *ready_next;	/* link to the next ready watch */
+  int scheduled;		/* is it ready or delivered by a worker? */
+  keynode_t node;		/* the key node given to the callbacks */
+};
+
+#if !defined(NO_GLIB)
+/*
+ * structure for the sources running callbacks in main contexts
+ */
+struct loop
+{
+  GSource source;		/* the glib source, must be first */
+  struct loop *next;		/* link to the next loop */
+  GMainContext *context;	/* the main context of the source */
+  unsigned refcount;		/* count of notifications using it */
+  struct event *queue;		/* queued events, the last first */
+};
+#endif
+
+/*
+ * structure for watched directories
+ */
+struct prefix
+{
+  struct prefix *next;		/* link to the next watched directory */
+  vconf_callback_fn callback;	/* the user callback */
+  void *userdata;		/* the user data */
+  size_t length;		/* length of the directory */
+  char directory[];		/* the directory, ending with '/' */
+};
+
+/*
+ * structure for the subscriptions receiving the changes by batch
+ */
+struct batch
+{
+  struct batch *next;		/* link to the next batch subscription */
+  vconf_batch_fn callback;	/* the user callback */
+  void *userdata;		/* the user data */
+  int removed;			/* is it removed? */
+  struct event *events;		/* the changes of the delivery pass */
+  struct batch *ready_next;	/* link to the next batch to deliver */
+};
+
+/*
+ * structure for prepared keys
+ */
+struct _vconf_key_t
+{
+  struct keycache *keys[type_bool + 1];	/* buxton keys by type or NULL */
+  struct cache_entry *entry;	/* entry of the shared cache or NULL */
+  unsigned generation;		/* generation of the cache of 'entry' */
+  unsigned hash;		/* hash of the key name */
+  const char *keyname;		/* name of the key */
+  const char *group;		/* group of the key */
+};
+
+/*
+ * structure for cached values
+ */
+struct cache_entry
+{
+  struct cache_entry *next;	/* link to the next entry of the bucket */
+  struct cache *cache;		/* the cache of the entry */
+  unsigned hash;		/* hash of the key name */
+  int status;			/* status of the notification */
+  int valid;			/* is the cached value valid? */
+  keynode_t node;		/* the cached key and its value */
+};
+
+/*
+ * structure for cached buxton keys
+ */
+struct keycache
+{
+  struct keycache *next;	/* link to the next entry of the bucket */
+  struct keycache *newer;	/* link to the more recently used entry */
+  struct keycache *older;	/* link to the less recently used entry */
+  unsigned hash;		/* hash of the key name */
+  int refcount;			/* count of references */
+  int is_cached;		/* is the entry in the cache? */
+  enum keytype type;		/* type of the key */
+  BuxtonKey key;		/* the buxton key */
+  const char *keyname;		/* name of the key */
+};
+
+/*
+ * structure for chunks of memory of arena lists
+ */
+struct arena_chunk
+{
+  struct arena_chunk *next;	/* link to the previously allocated chunk */
+  size_t size;			/* size of the memory following the chunk */
+  size_t used;			/* used size of that memory */
+};
+
+/*
+ * structure for the requests given up on the shared client
+ */
+struct orphan
+{
+  struct orphan *next;		/* link to the next orphan */
+  const void *data;		/* data of the callback of the request */
+};
+
+/*
+ * structure for the connections of the pool
+ */
+struct connection
+{
+  BuxtonClient client;		/* the buxton client */
+  int fd;			/* its file descriptor */
+  struct connection *next;	/* link to the next free connection */
+};
+
+/*
+ * structure for caches of values
+ */
+struct cache
+{
+  struct cache_entry **buckets;	/* buckets of the entries or NULL */
+  unsigned bucket_count;	/* count of buckets */
+  unsigned count;		/* count of entries */
+  unsigned capacity;		/* maximum count of entries */
+  unsigned generation;		/* incremented when the entries are freed */
+  vconf_ctx_t *ctx;		/* context of the cache or NULL if shared */
+};
+
+/*
+ * structure for contexts
+ */
+struct _vconf_ctx_t
+{
+  struct connection connection;	/* private connection (client NULL
+				 * when closed) */
+  char *group;			/* default group of the context */
+  int error;			/* error code for vconf_ctx_get_ext_errno */
+  struct cache cache;		/* cache of values of the context */
+};
+
 /*================= SECTION local variables =============*/
 
 /*
@@ -172,6 +402,31 @@ static size_t keyname_maximum_length = 2030;
  */
 static size_t keygroup_maximum_length = 1010;
 
+/*
+ * count of keys of a list above which the list is indexed 
+ */
+static int keylist_index_threshold = 16;
+
+/*
+ * maximum count of requests of a keylist waiting for their response 
+ */
+static unsigned pipeline_window = 64;
+
+/*
+ * maximum count of responses handled per wakeup of the dispatch
+ */
+static unsigned dispatch_budget = 64;
+
+/*
+ * maximum count of cached buxton keys 
+ */
+static unsigned keycache_maximum_count = 256;
+
+/*
+ * size of the chunks of memory of arena lists 
+ */
+static size_t arena_chunk_size = 16384;
+
 /*
  * association from prefixes to layers 
  */
@@ -185,7 +440,7 @@ static const char *assoc_prefix_layer[][2] = {
 };
 
 /*
- * default timeout in scanning responses 
+ * default timeout of the calls waiting for buxton, negative for none 
  */
 static int default_timeout = 5000;	/* in milliseconds */
 
@@ -204,6 +459,91 @@ static int the_buxton_client_fd = 0;
  */
 static char the_buxton_client_is_set = 0;
 
+/*
+ * generation of the buxton client, incremented when it is detached 
+ */
+static unsigned the_buxton_client_generation = 0;
+
+/*
+ * the requests given up on the shared buxton client whose responses
+ * are ignored, protected by the lock 'buxton'
+ */
+static struct orphan *the_buxton_orphans = NULL;
+
+/*
+ * flag indicating that the registrations of the watches were lost with
+ * the shared buxton client
+ */
+static int watches_lost = 0;
+
+/*
+ * count of operations using the shared buxton client 
+ */
+static int the_buxton_client_users = 0;
+
+/*
+ * flag indicating if a thread is polling the shared buxton client 
+ */
+static char the_buxton_reader_is_active = 0;
+
+#if !defined(NO_MULTITHREADING)
+/*
+ * event waking the thread polling the shared buxton client 
+ */
+static int the_buxton_reader_wakeup = -1;
+#endif
+
+/*
+ * the handle returned by vconf_get_fd() and the connection it watches
+ */
+static int dispatch_fd = -1;
+static int dispatch_watched_fd = -1;
+
+/*
+ * the timer of the handle of vconf_get_fd() retrying to connect while
+ * the watched keys are lost, and its period in milliseconds
+ */
+static int dispatch_retry_fd = -1;
+static const unsigned dispatch_retry_period = 1000;
+
+#if !defined(NO_MULTITHREADING)
+/*
+ * the dispatcher thread: thread, epoll handle, stop event and state
+ */
+static pthread_t dispatcher_thread;
+static int dispatcher_epoll = -1;
+static int dispatcher_stop = -1;
+static int dispatcher_running = 0;
+#endif
+
+/*
+ * flag indicating if the buxton client was already opened 
+ */
+static char the_buxton_client_was_opened = 0;
+
+/*
+ * policy for closing the unused connection to buxton 
+ */
+static vconf_connection_policy_t connection_policy = VCONF_CONNECTION_CLOSE;
+
+/*
+ * idle period before closing the connection (VCONF_CONNECTION_IDLE)
+ */
+static unsigned connection_idle_period = 0;	/* in milliseconds */
+
+/*
+ * time of the last release of the connection 
+ */
+static struct timespec connection_last_use;
+
+/*
+ * the pool of connections: free connections, maximum count of
+ * connections (0 when disabled) and count of opened connections
+ */
+static struct connection *pool_free = NULL;
+static unsigned pool_size = 0;
+static unsigned pool_count = 0;
+
 /*
  * the group to use if default group is unset 
  */
@@ -215,14 +555,75 @@ static const char initial_default_group[] = "vconf";
 static char *default_group = NULL;
 
 /*
- * the notify keylist 
+ * the registry of the watched keys: buckets, count of buckets and of keys
+ */
+static struct watch **watch_buckets = NULL;
+static unsigned watch_bucket_count = 0;
+static unsigned watch_count = 0;
+
+/*
+ * the watched directories
+ */
+static struct prefix *prefixes = NULL;
+
+/*
+ * the batch subscriptions and the removed ones not yet freed
+ */
+static struct batch *batches = NULL;
+static struct batch *retired_batches = NULL;
+
+/*
+ * count of threads using notifications without holding the lock 'notify'
+ */
+static unsigned notify_readers = 0;
+
+/*
+ * the objects removed from the registry, freed when no reader is active
+ */
+static struct notify *retired_notifies = NULL;
+static struct notify_set *retired_sets = NULL;
+static struct watch *retired_watches = NULL;
+
+/*
+ * the queued events, the last queued first, and the delivery flag
+ */
+static struct event *event_queue = NULL;
+static int event_delivering = 0;
+
+/*
+ * the notifications holding a delayed change, owned by the delivery,
+ * and the timer of their delivery with its expiration flag
+ */
+static struct notify *held_notifies = NULL;
+static int timer_fd = -1;
+static int timer_fired = 0;
+
+/*
+ * the batch subscriptions having changes, owned by the delivery
+ */
+static struct batch *ready_batches = NULL;
+
+#if !defined(NO_MULTITHREADING)
+/*
+ * the threads delivering the events: count, threads, count of the
+ * running ones and stop flag
+ */
+static unsigned worker_count = 0;
+static pthread_t *worker_threads = NULL;
+static unsigned workers_alive = 0;
+static int workers_stopping = 0;
+
+/*
+ * the watches having events for the workers, in their order of readiness
  */
-static keylist_t *notify_keylist = NULL;
+static struct watch *ready_first = NULL;
+static struct watch *ready_last = NULL;
+#endif
 
 /*
- * the notify entries 
+ * the pending asynchronous operations, protected by the lock 'buxton'
  */
-static struct notify *notify_entries = NULL;
+static struct async *async_pending = NULL;
 
 /*
  * the count of lists
@@ -234,6 +635,38 @@ static int internal_list_count = 0;
  * link to the glib main loop 
  */
 static GSource *glib_source = NULL;
+
+/*
+ * the file handle watched by glib_source 
+ */
+static int glib_source_fd = -1;
+
+/*
+ * link of the delivery timer to the glib main loop
+ */
+static GSource *glib_timer_source = NULL;
+
+/*
+ * the timer closing the idle connection 
+ */
+static guint glib_idle_timer = 0;
+
+/*
+ * the main context of glib_source and glib_idle_timer, NULL for default
+ */
+static GMainContext *glib_context = NULL;
+
+/*
+ * the sources running callbacks in other main contexts
+ */
+static struct loop *loops = NULL;
+
+/*
+ * the source running the callbacks in glib_context when it is set and
+ * the count of threads posting to it
+ */
+static struct loop *glib_loop = NULL;
+static int glib_loop_posting = 0;
 #endif
 
 /*
@@ -241,6 +674,31 @@ static GSource *glib_source = NULL;
  */
 static int g_vconf_errno = 0;
 
+/*
+ * the shared cache of values
+ */
+static struct cache the_cache = { NULL, 0, 0, 0, 0, NULL };
+
+/*
+ * the cache of buxton keys: buckets, count of entries and LRU list
+ */
+static struct keycache *keycache_buckets[256];
+static unsigned keycache_count = 0;
+static struct keycache *keycache_newest = NULL;
+static struct keycache *keycache_oldest = NULL;
+
+/*
+ * statistics
+ */
+static unsigned long stat_cache_hits = 0;
+static unsigned long stat_cache_misses = 0;
+static unsigned long stat_reconnects = 0;
+static unsigned long stat_keys_created = 0;
+static unsigned long stat_requests = 0;
+static unsigned long stat_polls = 0;
+static unsigned long stat_wakeups = 0;
+static unsigned long stat_responses = 0;
+
 #if !defined(NO_MULTITHREADING)
 /*
  * multithreaded protection
@@ -249,12 +707,25 @@ static int g_vconf_errno = 0;
 static pthread_mutex_t mutex_notify = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mutex_counter = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mutex_buxton = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutex_cache = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutex_keys = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mutex_group = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutex_pool = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutex_workers = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutex_dispatcher = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_buxton = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t cond_workers = PTHREAD_COND_INITIALIZER;
 #define LOCK(x) pthread_mutex_lock(&mutex_##x)
 #define UNLOCK(x) pthread_mutex_unlock(&mutex_##x)
+#define TRYLOCK(x) pthread_mutex_trylock(&mutex_##x)
+#define BROADCAST(x) pthread_cond_broadcast(&cond_##x)
+#define STAT_INC(x) __sync_fetch_and_add(&stat_##x, 1)
 #else
 #define LOCK(x)
 #define UNLOCK(x)
+#define TRYLOCK(x) 0
+#define BROADCAST(x)
+#define STAT_INC(x) (stat_##x++)
 #endif
 
 /*================= SECTION utils =============*/
@@ -285,53 +756,216 @@ _dup_ (const char *source, size_t maxlen, const char *tag)
   return result;
 }
 
-/*================= SECTION groupname utils =============*/
-
-static inline char *
-_dup_groupname_ (const char *groupname)
+/*
+ * hash of a key name (FNV-1a)
+ */
+static inline unsigned
+_hash_name_ (const char *name)
 {
-  return _dup_ (groupname, keygroup_maximum_length, "group-name");
+  unsigned result = 2166136261u;
+
+  while (*name)
+    result = (result ^ (unsigned char) *name++) * 16777619u;
+  return result;
 }
 
+/*
+ * the timeout of the calls without explicit timeout, set at any time by
+ * vconf_set_timeout()
+ */
 static inline int
-_ensure_default_group_ ()
+_default_timeout_ ()
 {
-  int result = VCONF_OK;
+  return __atomic_load_n (&default_timeout, __ATOMIC_RELAXED);
+}
 
-  LOCK (group);
-  if (default_group == NULL)
+/*
+ * computes in 'deadline' the time 'timeout' milliseconds after now.
+ * returns 'deadline' or NULL if 'timeout' is negative (no deadline)
+ */
+static inline const struct timespec *
+_deadline_ (struct timespec *deadline, int timeout)
+{
+  if (timeout < 0)
+    return NULL;
+  clock_gettime (CLOCK_MONOTONIC, deadline);
+  deadline->tv_sec += timeout / 1000;
+  deadline->tv_nsec += (long) (timeout % 1000) * 1000000;
+  if (deadline->tv_nsec >= 1000000000)
     {
-      default_group = _dup_groupname_ (initial_default_group);
-      if (default_group == NULL)
-	result = VCONF_ERROR;
+      deadline->tv_sec++;
+      deadline->tv_nsec -= 1000000000;
     }
-  UNLOCK (group);
-
-  return result;
+  return deadline;
 }
 
-/*================= SECTION key utils =============*/
-
-static inline void
-_keynode_free_ (keynode_t * keynode)
+/*
+ * milliseconds remaining before 'deadline', rounded up, or -1 if NULL
+ */
+static inline int
+_remaining_ (const struct timespec *deadline)
 {
-  assert (keynode != NULL);
-  if (keynode->type == type_string)
-    free (keynode->value.s);
-  free (keynode);
+  struct timespec now;
+  long ms;
+
+  if (deadline == NULL)
+    return -1;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  if (now.tv_sec > deadline->tv_sec + 1000000)
+    return 0;
+  ms = (long) (deadline->tv_sec - now.tv_sec) * 1000
+    + (deadline->tv_nsec - now.tv_nsec + 999999) / 1000000;
+  return ms > 0 ? (int) ms : 0;
 }
 
-static inline size_t
-_check_keyname_ (const char *keyname)
+/*
+ * the monotonic time in milliseconds
+ */
+static inline unsigned long long
+_now_ms_ ()
 {
-  size_t result;
+  struct timespec now;
 
-  assert (keyname != NULL);
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (unsigned long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
-  if (*keyname == '/')
-    {
-      return 0;
-    }
+/*
+ * allocation of 'size' bytes in the arena whose newest chunk is '*arena'
+ */
+static void *
+_arena_alloc_ (struct arena_chunk **arena, size_t size)
+{
+  struct arena_chunk *chunk;
+  size_t chunksz;
+  void *result;
+
+  size = (size + 7) & ~(size_t) 7;
+  chunk = *arena;
+  if (chunk == NULL || chunk->size - chunk->used < size)
+    {
+      chunksz = size > arena_chunk_size / 4 ? size : arena_chunk_size;
+      chunk = malloc (chunksz + sizeof *chunk);
+      if (chunk == NULL)
+	return NULL;
+      chunk->size = chunksz;
+      chunk->used = 0;
+      if (size == chunksz && *arena != NULL)
+	{
+	  /*
+	   * dedicated chunk: keep the current one for the next allocations 
+	   */
+	  chunk->next = (*arena)->next;
+	  (*arena)->next = chunk;
+	}
+      else
+	{
+	  chunk->next = *arena;
+	  *arena = chunk;
+	}
+    }
+  result = (char *) (chunk + 1) + chunk->used;
+  chunk->used += size;
+  return result;
+}
+
+/*
+ * release of all the chunks of an arena
+ */
+static void
+_arena_free_ (struct arena_chunk *arena)
+{
+  struct arena_chunk *next;
+
+  while (arena != NULL)
+    {
+      next = arena->next;
+      free (arena);
+      arena = next;
+    }
+}
+
+/*================= SECTION groupname utils =============*/
+
+static inline char *
+_dup_groupname_ (const char *groupname)
+{
+  return _dup_ (groupname, keygroup_maximum_length, "group-name");
+}
+
+static inline int
+_ensure_default_group_ ()
+{
+  int result = VCONF_OK;
+
+  LOCK (group);
+  if (default_group == NULL)
+    {
+      default_group = _dup_groupname_ (initial_default_group);
+      if (default_group == NULL)
+	result = VCONF_ERROR;
+    }
+  UNLOCK (group);
+
+  return result;
+}
+
+/*================= SECTION key utils =============*/
+
+static inline int
+_keynode_is_arena_ (keynode_t * keynode)
+{
+  return keynode->list != NULL && keynode->list->arena != NULL;
+}
+
+static inline void
+_keynode_free_string_ (keynode_t * keynode)
+{
+  if (keynode->type == type_string && !_keynode_is_arena_ (keynode))
+    free (keynode->value.s);
+}
+
+static inline void
+_keynode_free_ (keynode_t * keynode)
+{
+  assert (keynode != NULL);
+  if (!_keynode_is_arena_ (keynode))
+    {
+      if (keynode->type == type_string)
+	free (keynode->value.s);
+      free (keynode);
+    }
+}
+
+static inline enum keytype
+_keytype_of_vconf_type_ (int type)
+{
+  switch (type)
+    {
+    case VCONF_TYPE_STRING:
+      return type_string;
+    case VCONF_TYPE_INT:
+      return type_int;
+    case VCONF_TYPE_DOUBLE:
+      return type_double;
+    case VCONF_TYPE_BOOL:
+      return type_bool;
+    default:
+      return type_unset;
+    }
+}
+
+static inline size_t
+_check_keyname_ (const char *keyname)
+{
+  size_t result;
+
+  assert (keyname != NULL);
+
+  if (*keyname == '/')
+    {
+      return 0;
+    }
 
   for (result = 0; keyname[result]; result++)
     {
@@ -346,6 +980,68 @@ _check_keyname_ (const char *keyname)
 
 /*================= SECTION list utils =============*/
 
+/*
+ * add 'keynode' to the hash index of 'keylist' 
+ */
+static inline void
+_keylist_index_add_ (keylist_t * keylist, keynode_t * keynode)
+{
+  keynode_t **bucket;
+
+  bucket = &keylist->index[keynode->hash & (keylist->index_size - 1)];
+  keynode->hnext = *bucket;
+  *bucket = keynode;
+}
+
+/*
+ * (re)build the hash index of 'keylist' for its current count of keys.
+ * On allocation error, the previous state is kept.
+ */
+static void
+_keylist_index_ (keylist_t * keylist)
+{
+  keynode_t **index, *keynode;
+  unsigned size;
+
+  size = keylist->index_size ? keylist->index_size : 16;
+  while (size < (unsigned) keylist->num)
+    size <<= 1;
+  index = calloc (size, sizeof *index);
+  if (index == NULL)
+    return;
+
+  free (keylist->index);
+  keylist->index = index;
+  keylist->index_size = size;
+  for (keynode = keylist->head; keynode != NULL; keynode = keynode->next)
+    _keylist_index_add_ (keylist, keynode);
+}
+
+/*
+ * remove 'keynode' from 'keylist' without freeing it 
+ */
+static inline void
+_keylist_unlink_ (keylist_t * keylist, keynode_t * keynode)
+{
+  keynode_t **prev;
+
+  assert (keynode->list == keylist);
+  assert (*keynode->prev == keynode);
+
+  *keynode->prev = keynode->next;
+  if (keynode->next)
+    keynode->next->prev = keynode->prev;
+  keylist->num--;
+
+  if (keylist->index != NULL)
+    {
+      prev = &keylist->index[keynode->hash & (keylist->index_size - 1)];
+      while (*prev != keynode)
+	prev = &(*prev)->hnext;
+      *prev = keynode->hnext;
+    }
+}
+
 /*
  * search in 'keylist' an entry of 'keyname' and return it if found or
  * NULL if not found. 'previous' if not NULL and if the entry is found
@@ -355,25 +1051,27 @@ static inline keynode_t *
 _keylist_lookup_ (keylist_t * keylist,
 		  const char *keyname, keynode_t *** previous)
 {
-  keynode_t *node, **prev;
-  size_t length = 1 + strlen (keyname);
+  keynode_t *node;
+  unsigned hash = _hash_name_ (keyname);
 
-  prev = &keylist->head;
-  node = keylist->head;
-  while (node)
+  if (keylist->index != NULL)
     {
-      assert (node->keyname != NULL);
-      if (!memcmp (keyname, node->keyname, length))
-	{
-	  if (previous)
-	    *previous = prev;
-	  return node;
-	}
-
-      prev = &node->next;
-      node = node->next;
+      node = keylist->index[hash & (keylist->index_size - 1)];
+      while (node != NULL
+	     && (node->hash != hash || strcmp (keyname, node->keyname)))
+	node = node->hnext;
+    }
+  else
+    {
+      node = keylist->head;
+      while (node != NULL
+	     && (node->hash != hash || strcmp (keyname, node->keyname)))
+	node = node->next;
     }
-  return NULL;
+
+  if (node != NULL && previous)
+    *previous = node->prev;
+  return node;
 }
 
 static inline keynode_t *
@@ -389,7 +1087,10 @@ _keylist_add_ (keylist_t * keylist, const char *keyname, enum keytype type)
   length = _check_keyname_ (keyname);
   retvm_if (!length, NULL, "invalid keyname");
   retvm_if (length > keyname_maximum_length, NULL, "keyname too long");
-  result = malloc (1 + length + sizeof *result);
+  if (keylist->arena != NULL)
+    result = _arena_alloc_ (&keylist->arena, 1 + length + sizeof *result);
+  else
+    result = malloc (1 + length + sizeof *result);
   retvm_if (result == NULL, NULL, "allocation of keynode failed");
   result->type = type;
   result->value.s = NULL;
@@ -398,11 +1099,22 @@ _keylist_add_ (keylist_t * keylist, const char *keyname, enum keytype type)
   name = (char *) (result + 1);
   result->keyname = name;
   memcpy (name, keyname, length + 1);
+  result->hash = _hash_name_ (name);
 
   result->next = keylist->head;
+  result->prev = &keylist->head;
+  if (keylist->head)
+    keylist->head->prev = &result->next;
   keylist->head = result;
   keylist->num++;
 
+  if (keylist->index != NULL)
+    _keylist_index_add_ (keylist, result);
+  if (keylist->num > keylist_index_threshold
+      && (keylist->index == NULL
+	  || (unsigned) keylist->num > keylist->index_size))
+    _keylist_index_ (keylist);
+
   return result;
 }
 
@@ -424,8 +1136,7 @@ _keylist_getadd_ (keylist_t * keylist, const char *keyname, enum keytype type)
     }
   else if (result->type != type)
     {
-      if (result->type == type_string)
-	free (result->value.s);
+      _keynode_free_string_ (result);
       result->type = type;
       result->value.s = NULL;
     }
@@ -460,1476 +1171,5787 @@ _keylist_init_singleton_ (struct singleton *singleton, const char *keyname,
 
 /*================= SECTION buxton =============*/
 
-static void
-_check_close_buxton_ ()
+static void _cache_flush_ (struct cache *cache);
+static void _deliver_events_ ();
+static void _notify_recover_ ();
+static inline void _event_push_ (struct event **queue, struct event *event);
+static void _cache_put_list_ (struct cache *cache, keylist_t * keylist);
+#if !defined(NO_GLIB)
+static int _loop_post_ (struct event *event);
+static int _main_post_ (struct event *event);
+static void _loop_release_ (struct loop *loop);
+static int _glib_start_watch_ ();
+static struct loop *_loop_get_ (GMainContext * context);
+#endif
+static void _prefix_catch_ (keylist_t * keylist);
+
+/*
+ * wake the threads waiting for the shared client, the lock 'buxton'
+ * must be held
+ */
+static inline void
+_wake_buxton_reader_ ()
 {
-  BuxtonClient bc;
+#if !defined(NO_MULTITHREADING)
+  uint64_t one = 1;
 
-  LOCK (notify);
-  LOCK (counter);
-  if (internal_list_count == 0 && notify_entries == NULL)
-    if (internal_list_count == 0 && notify_entries == NULL)
-      {
-	LOCK (buxton);
-	bc = the_buxton_client;
-	the_buxton_client_is_set = 0;
-	the_buxton_client = NULL;
-	the_buxton_client_fd = -1;
-	UNLOCK (buxton);
-	if (bc)
-	  buxton_close (bc);
-      }
-  UNLOCK (counter);
-  UNLOCK (notify);
+  if (the_buxton_reader_is_active && the_buxton_reader_wakeup >= 0)
+    {
+      if (write (the_buxton_reader_wakeup, &one, sizeof one) < 0)
+	ERR ("Can't wake the reader: %m");
+    }
+#endif
+  BROADCAST (buxton);
 }
 
+/*
+ * makes the handle of vconf_get_fd() watch the current connection,
+ * the lock 'buxton' must be held
+ */
+static void
+_dispatch_retry_ (int arm);
+
 static void
-_try_to_open_buxton_ ()
+_dispatch_update_ ()
 {
-  the_buxton_client_fd = buxton_open (&the_buxton_client);
-  if (the_buxton_client_fd < 0)
+  struct epoll_event event;
+
+  if (dispatch_fd < 0 || dispatch_watched_fd == the_buxton_client_fd)
+    return;
+
+  _dispatch_retry_ (the_buxton_client_fd < 0
+		    && __atomic_load_n (&watch_count, __ATOMIC_RELAXED) != 0);
+
+  if (dispatch_watched_fd >= 0)
+    epoll_ctl (dispatch_fd, EPOLL_CTL_DEL, dispatch_watched_fd, NULL);
+  dispatch_watched_fd = -1;
+  if (the_buxton_client_fd >= 0)
     {
-      ERR ("can't connect to buxton server: %m");
-      errno = ENOTCONN;
-      the_buxton_client = NULL;
+      event.events = EPOLLIN;
+      event.data.fd = the_buxton_client_fd;
+      if (epoll_ctl (dispatch_fd, EPOLL_CTL_ADD, the_buxton_client_fd,
+		     &event) == 0)
+	dispatch_watched_fd = the_buxton_client_fd;
+      else
+	ERR ("Can't watch the connection: %m");
     }
 }
 
-static inline int
-_open_buxton_ ()
+/*
+ * arms or disarms the timer making the handle of vconf_get_fd() readable
+ * periodically, so that vconf_dispatch_pending() tries again to connect
+ * and to register the watched keys. the lock 'buxton' must be held.
+ */
+static void
+_dispatch_retry_ (int arm)
 {
-  LOCK (buxton);
-  if (!the_buxton_client_is_set)
+  struct itimerspec spec;
+  struct epoll_event event;
+
+  if (dispatch_retry_fd < 0)
     {
-      /*
-       * first time, try to connect to buxton 
-       */
-      the_buxton_client_is_set = 1;
-      _try_to_open_buxton_ ();
+      if (!arm)
+	return;
+      dispatch_retry_fd = timerfd_create (CLOCK_MONOTONIC,
+					  TFD_NONBLOCK | TFD_CLOEXEC);
+      if (dispatch_retry_fd < 0)
+	{
+	  ERR ("Can't create the retry timer: %m");
+	  return;
+	}
+      event.events = EPOLLIN;
+      event.data.fd = dispatch_retry_fd;
+      if (epoll_ctl (dispatch_fd, EPOLL_CTL_ADD, dispatch_retry_fd,
+		     &event) < 0)
+	{
+	  ERR ("Can't watch the retry timer: %m");
+	  close (dispatch_retry_fd);
+	  dispatch_retry_fd = -1;
+	  return;
+	}
     }
-  UNLOCK (buxton);
-  return the_buxton_client != NULL;
-}
 
+  memset (&spec, 0, sizeof spec);
+  if (arm)
+    {
+      spec.it_value.tv_sec = dispatch_retry_period / 1000;
+      spec.it_value.tv_nsec = (dispatch_retry_period % 1000) * 1000000;
+      spec.it_interval = spec.it_value;
+    }
+  if (timerfd_settime (dispatch_retry_fd, 0, &spec, NULL) < 0)
+    ERR ("Can't set the retry timer: %m");
+}
 
-static inline BuxtonClient
-_buxton_ ()
+/*
+ * adds the delivery timer to the handle of vconf_get_fd().
+ * the lock 'buxton' must be held.
+ */
+static void
+_dispatch_add_timer_ ()
 {
-  BuxtonClient result = the_buxton_client;
-  assert (result != NULL);
-  return result;
+  struct epoll_event event;
+
+  if (dispatch_fd < 0 || timer_fd < 0)
+    return;
+  event.events = EPOLLIN;
+  event.data.fd = timer_fd;
+  if (epoll_ctl (dispatch_fd, EPOLL_CTL_ADD, timer_fd, &event) < 0)
+    ERR ("Can't watch the delivery timer: %m");
 }
 
-static inline int
-_handle_buxton_response_ (int lock)
+/*
+ * creates the timer delivering the held changes.
+ * the lock 'notify' must be held.
+ */
+static int
+_timer_open_ ()
 {
-  int result;
+  int fd;
 
-  if (lock)
-    LOCK (buxton);
-  result = buxton_client_handle_response (_buxton_ ());
-  if (result < 0)
-    ERR ("Error in buxton_client_handle_response: %m");
-  if (result == 0) {
-    ERR ("Connection closed");
-    result = -1;
-  }
-  if (lock)
-    UNLOCK (buxton);
-  return result;
+  if (timer_fd >= 0)
+    return VCONF_OK;
+  fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  retvm_if (fd < 0, VCONF_ERROR, "Can't create the delivery timer: %m");
+  LOCK (buxton);
+  timer_fd = fd;
+  _dispatch_add_timer_ ();
+  UNLOCK (buxton);
+  return VCONF_OK;
 }
 
-static inline int
-_dispatch_buxton_ (int writing, int lock)
+/*
+ * ends the waits of the pending asynchronous operations on a lost
+ * client, the lock 'buxton' must be held
+ */
+static void
+_async_abort_ ()
 {
-  int status;
-  struct pollfd pfd;
-
-  assert (_buxton_ () != NULL);
+  struct async *async;
+  keylist_t *keylist;
+  keynode_t *keynode;
 
-  pfd.fd = the_buxton_client_fd;
-  pfd.events = writing ? POLLIN | POLLOUT : POLLIN;
-  for (;;)
+  for (async = async_pending; async != NULL; async = async->next)
     {
-      pfd.revents = 0;
-      status = poll (&pfd, 1, default_timeout);
-      if (status == -1)
-	{
-	  if (errno != EINTR)
-	    {
-	      return VCONF_ERROR;
-	    }
-	}
-      else if (status == 1)
+      keylist = async->keylist;
+      if (keylist->cb_sent != keylist->cb_received)
 	{
-	  if (pfd.revents & POLLIN)
-	    {
-	      status = _handle_buxton_response_ (lock);
-	      if (status < 0)
-		{
-		  return VCONF_ERROR;
-		}
-	      if (!writing)
-		{
-		  return VCONF_OK;
-		}
-	    }
-	  if (pfd.revents & POLLOUT)
-	    {
-	      return VCONF_OK;
-	    }
-	  else
-	    {
-	      return VCONF_ERROR;
-	    }
+	  for (keynode = keylist->head; keynode != NULL;
+	       keynode = keynode->next)
+	    if (keynode->status == KEYNODE_PENDING)
+	      keynode->status = VCONF_ERROR;
+	  keylist->cb_status = VCONF_ERROR;
+	  keylist->cb_received = keylist->cb_sent;
+	  _event_push_ (&event_queue, &async->event);
 	}
     }
 }
 
+/*
+ * ignores the response to a request of the shared client whose
+ * callback gets 'data', the lock 'buxton' must be held.
+ * returns 0 or -1 if it can't be recorded.
+ */
+static int
+_orphan_add_ (const void *data)
+{
+  struct orphan *orphan;
+
+  orphan = malloc (sizeof *orphan);
+  retvm_if (orphan == NULL, -1, "Allocation of orphan failed");
+  orphan->data = data;
+  orphan->next = the_buxton_orphans;
+  the_buxton_orphans = orphan;
+  return 0;
+}
+
+/*
+ * tells if the response whose callback gets 'data' is ignored and
+ * forgets it, the lock 'buxton' must be held. As the responses come in
+ * the order of the requests, the given up request of 'data' is answered
+ * before any later one reusing the same 'data'.
+ */
 static inline int
-_wait_buxton_response_ (int *pending)
+_orphan_take_ (const void *data)
 {
-  int result;
+  struct orphan **prev, *orphan;
 
-  do
+  for (prev = &the_buxton_orphans; (orphan = *prev) != NULL;
+       prev = &orphan->next)
+    if (orphan->data == data)
+      {
+	*prev = orphan->next;
+	free (orphan);
+	return 1;
+      }
+  return 0;
+}
+
+/*
+ * detach the client, the lock 'buxton' must be held
+ */
+static inline BuxtonClient
+_detach_buxton_ ()
+{
+  BuxtonClient result;
+  struct orphan *orphan;
+
+  while ((orphan = the_buxton_orphans) != NULL)
     {
-      result = _dispatch_buxton_ (0, 1);
+      the_buxton_orphans = orphan->next;
+      free (orphan);
     }
-  while (result == VCONF_OK && *pending);
+  result = the_buxton_client;
+  the_buxton_client_is_set = 0;
+  the_buxton_client = NULL;
+  the_buxton_client_fd = -1;
+  the_buxton_client_generation++;
+  _dispatch_update_ ();
+  _async_abort_ ();
+  _wake_buxton_reader_ ();
   return result;
 }
 
-static inline int
-_get_layer_key_ (const char *keyname, struct layer_key *laykey)
+/*
+ * drop the client after an error of the connection, the lock 'buxton'
+ * must be held. The next use will reconnect.
+ */
+static void
+_drop_buxton_ ()
 {
-  int i, j;
-  const char *prefix;
+  BuxtonClient bc;
 
-  /*
-   * get the names 
-   */
-  i = 0;
-  prefix = assoc_prefix_layer[i][0];
-  while (prefix != NULL)
-    {
-      for (j = 0; prefix[j] && prefix[j] == keyname[j]; j++);
-      if (!prefix[j] && (!keyname[j] || keyname[j] == '/'))
-	{
-	  laykey->prefix = prefix;
-	  laykey->layer = assoc_prefix_layer[i][1];
-#if defined(REMOVE_PREFIXES)
-	  laykey->key = keyname + j + (keyname[j] == '/');
-#else
-	  laykey->key = keyname;
-#endif
-	  return VCONF_OK;
-	}
-      i++;
-      prefix = assoc_prefix_layer[i][0];
-    }
-  ERR ("Invalid argument: wrong prefix of key(%s)", keyname);
-  return VCONF_ERROR;
+  ERR ("Dropping the connection to buxton");
+  bc = _detach_buxton_ ();
+  __atomic_store_n (&watches_lost, 1, __ATOMIC_RELEASE);
+  _cache_flush_ (&the_cache);
+  if (bc)
+    buxton_close (bc);
 }
 
-static inline BuxtonKey
-_get_buxton_key_ (keynode_t * node)
+static inline unsigned
+_idle_time_ ()
 {
-  BuxtonDataType type;
-  struct layer_key laykey;
+  struct timespec now;
 
-  /*
-   * get layer and key 
-   */
-  if (_get_layer_key_ (node->keyname, &laykey) != VCONF_OK)
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (unsigned) ((now.tv_sec - connection_last_use.tv_sec) * 1000
+		     + (now.tv_nsec - connection_last_use.tv_nsec) / 1000000);
+}
+
+#if !defined(NO_GLIB)
+static gboolean _cb_glib_idle_ (gpointer data);
+#endif
+
+/*
+ * arm the timer closing the idle connection, the lock 'buxton' must
+ * be held. Without glib the connection is kept.
+ */
+static inline void
+_arm_idle_timer_ (unsigned delay)
+{
+#if !defined(NO_GLIB)
+  GSource *timer;
+
+  if (glib_idle_timer == 0)
     {
-      return NULL;
+      timer = g_timeout_source_new (delay);
+      if (timer == NULL)
+	return;
+      g_source_set_callback (timer, _cb_glib_idle_, NULL, NULL);
+      glib_idle_timer = g_source_attach (timer, glib_context);
+      g_source_unref (timer);
     }
+#endif
+}
 
-  /*
-   * get type 
-   */
-  switch (node->type)
+/*
+ * close the connection if it is unused and if the policy allows it.
+ * 'expired' tells if the idle period is elapsed.
+ */
+static void
+_close_unused_buxton_ (int expired)
+{
+  BuxtonClient bc;
+  unsigned idle;
+
+  bc = NULL;
+  LOCK (notify);
+  LOCK (counter);
+  if (internal_list_count == 0 && watch_count == 0)
     {
-    case type_string:
-      type = BUXTON_TYPE_STRING;
-      break;
-    case type_int:
-      type = BUXTON_TYPE_INT32;
-      break;
-    case type_double:
-      type = BUXTON_TYPE_DOUBLE;
-      break;
-    case type_bool:
-      type = BUXTON_TYPE_BOOLEAN;
-      break;
-    default:
-      type = BUXTON_TYPE_UNSET;
+      LOCK (buxton);
+      if (the_cache.count == 0 && the_buxton_client_is_set
+	  && the_buxton_client_users == 0)
+	switch (connection_policy)
+	  {
+	  case VCONF_CONNECTION_IDLE:
+	    if (!expired)
+	      {
+		clock_gettime (CLOCK_MONOTONIC, &connection_last_use);
+		_arm_idle_timer_ (connection_idle_period);
+		break;
+	      }
+	    idle = _idle_time_ ();
+	    if (idle < connection_idle_period)
+	      {
+		_arm_idle_timer_ (connection_idle_period - idle);
+		break;
+	      }
+	    bc = _detach_buxton_ ();
+	    break;
+	  case VCONF_CONNECTION_CLOSE:
+	    bc = _detach_buxton_ ();
+	    break;
+	  default:
+	    break;
+	  }
+      UNLOCK (buxton);
     }
+  UNLOCK (counter);
+  UNLOCK (notify);
+  if (bc)
+    buxton_close (bc);
+}
 
-  return buxton_key_create (default_group, laykey.key, laykey.layer, type);
+static void
+_check_close_buxton_ ()
+{
+  _close_unused_buxton_ (0);
 }
 
-/*================= SECTION set/unset/refresh =============*/
+#if !defined(NO_GLIB)
+static gboolean
+_cb_glib_idle_ (gpointer data)
+{
+  LOCK (buxton);
+  if (g_source_get_id (g_main_current_source ()) == glib_idle_timer)
+    glib_idle_timer = 0;
+  UNLOCK (buxton);
+  _close_unused_buxton_ (1);
+  return G_SOURCE_REMOVE;
+}
+#endif
 
 static void
-_cb_inc_received_ (BuxtonResponse resp, keynode_t * keynode)
+_try_to_open_buxton_ ()
 {
-  keylist_t *list;
-
-  assert (keynode != NULL);
-  assert (keynode->list != NULL);
+#if !defined(NO_MULTITHREADING)
+  if (the_buxton_reader_wakeup < 0)
+    the_buxton_reader_wakeup = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
 
-  list = keynode->list;
-  list->cb_received++;
-  if ((g_vconf_errno = buxton_response_status (resp)) != 0)
+  the_buxton_client_fd = buxton_open (&the_buxton_client);
+  if (the_buxton_client_fd < 0)
     {
-      ERR ("Buxton returned error %d for key %s",
-	   buxton_response_status (resp), keynode->keyname);
-      list->cb_status = VCONF_ERROR;
+      ERR ("can't connect to buxton server: %m");
+      errno = ENOTCONN;
+      the_buxton_client = NULL;
+      /*
+       * the next use tries again, whatever the connection policy 
+       */
+      the_buxton_client_is_set = 0;
     }
+  else if (the_buxton_client_was_opened)
+    STAT_INC (reconnects);
+  else
+    the_buxton_client_was_opened = 1;
+  _dispatch_update_ ();
 }
 
-static int
-_set_response_to_keynode_ (BuxtonResponse resp, keynode_t * keynode,
-			   int force)
+static inline int
+_open_buxton_ ()
 {
-  enum keytype type;
-  BuxtonDataType buxtyp;
-  void *buxval;
-
-  assert (keynode != NULL);
-  assert (buxton_response_status (resp) == 0);
-
-  buxtyp = buxton_response_value_type (resp);
-  switch (buxtyp)
+  LOCK (buxton);
+  if (!the_buxton_client_is_set)
     {
-    case BUXTON_TYPE_STRING:
-      type = type_string;
-      break;
-    case BUXTON_TYPE_INT32:
-      type = type_int;
-      break;
-    case BUXTON_TYPE_DOUBLE:
-      type = type_double;
-      break;
-    case BUXTON_TYPE_BOOLEAN:
-      type = type_bool;
-      break;
-    default:
-      return VCONF_ERROR;
+      /*
+       * first time or after a failure, try to connect to buxton 
+       */
+      the_buxton_client_is_set = 1;
+      _try_to_open_buxton_ ();
     }
+  UNLOCK (buxton);
+  return the_buxton_client != NULL;
+}
 
-  if (force && type != keynode->type && keynode->type != type_unset)
-    return VCONF_ERROR;
 
-  buxval = buxton_response_value (resp);
-  if (buxval == NULL)
-    return VCONF_ERROR;
+static inline BuxtonClient
+_buxton_ ()
+{
+  BuxtonClient result = the_buxton_client;
+  assert (result != NULL);
+  return result;
+}
 
-  if (keynode->type == type_string)
-    free (keynode->value.s);
+static inline int
+_handle_buxton_response_ (int lock)
+{
+  int result;
 
-  keynode->type = type;
-  switch (type)
+  if (lock)
+    LOCK (buxton);
+  if (the_buxton_client == NULL)
+    result = -1;
+  else
     {
-    case type_string:
-      keynode->value.s = buxval;
-      return VCONF_OK;
-    case type_int:
-      keynode->value.i = (int) *(int32_t *) buxval;
-      break;
-    case type_double:
-      keynode->value.d = *(double *) buxval;
-      break;
-    case type_bool:
-      keynode->value.b = *(bool *) buxval;
-      break;
-    default:
-      assert (0);
-      break;
+      result = buxton_client_handle_response (_buxton_ ());
+      if (result < 0 && errno == EAGAIN)
+	result = 1;		/* already read by an other thread */
+      else if (result < 0)
+	ERR ("Error in buxton_client_handle_response: %m");
+      if (result == 0)
+	ERR ("Connection closed");
+      if (result <= 0)
+	{
+	  _drop_buxton_ ();
+	  result = -1;
+	}
+      else
+	_wake_buxton_reader_ ();
     }
-  free (buxval);
-  return VCONF_OK;
+  if (lock)
+    UNLOCK (buxton);
+  return result;
 }
 
-static void
-_cb_refresh_ (BuxtonResponse resp, keynode_t * keynode)
+/*
+ * handles the responses readable without blocking, at most the budget
+ * of a wakeup, the first one being known readable if 'readable'. Its
+ * polls don't wait, they aren't counted in the polls.
+ * returns the count handled or -1 if the connection was dropped.
+ * the lock 'buxton' must be held.
+ */
+static int
+_drain_buxton_ (int readable)
 {
-  keylist_t *list;
-
-  assert (keynode != NULL);
-  assert (keynode->list != NULL);
-  assert (buxton_response_type (resp) == BUXTON_CONTROL_GET);
+  struct pollfd pfd;
+  int count;
 
-  list = keynode->list;
-  list->cb_received++;
-  if ((g_vconf_errno = buxton_response_status (resp)) != 0)
-    {
-      ERR ("Error %d while getting buxton key %s",
-	   buxton_response_status (resp), keynode->keyname);
-      list->cb_status = VCONF_ERROR;
-    }
-  else if (_set_response_to_keynode_ (resp, keynode, 0) != VCONF_OK)
+  for (count = 0; (unsigned) count < dispatch_budget; count++)
     {
-      list->cb_status = VCONF_ERROR;
+      if (the_buxton_client == NULL)
+	break;
+      if (count != 0 || !readable)
+	{
+	  pfd.fd = the_buxton_client_fd;
+	  pfd.events = POLLIN;
+	  pfd.revents = 0;
+	  if (poll (&pfd, 1, 0) != 1)
+	    break;
+	}
+      if (_handle_buxton_response_ (0) < 0)
+	return -1;
+      STAT_INC (responses);
     }
+  if (count != 0)
+    STAT_INC (wakeups);
+  return count;
 }
 
-static void
-_cb_scan_ (BuxtonResponse resp, struct scanning_data *data)
+/*
+ * handles without waiting the responses already received and checks
+ * that the connection is still alive
+ */
+static inline int
+_sync_buxton_ (int lock)
 {
-  char *buxname;
-  char *name;
-  char *term;
-  uint32_t count;
-  uint32_t index;
-  keylist_t *keylist;
-  keynode_t *keynode;
-  int length;
+  struct pollfd pfd;
 
-  data->pending = 0;
+  assert (_buxton_ () != NULL);
 
-  /*
-   * check the response status 
-   */
-  if ((g_vconf_errno = buxton_response_status (resp)) != 0)
+  pfd.fd = the_buxton_client_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  STAT_INC (polls);
+  if (poll (&pfd, 1, 0) != 1)
+    return VCONF_OK;
+  if ((pfd.revents & POLLIN) && _handle_buxton_response_ (lock) > 0)
+    return VCONF_OK;
+  if (lock)
+    LOCK (buxton);
+  if (the_buxton_client != NULL)
+    _drop_buxton_ ();
+  if (lock)
+    UNLOCK (buxton);
+  return VCONF_ERROR;
+}
+
+#if !defined(NO_MULTITHREADING)
+/*
+ * waits until 'deadline' that an other thread handles responses of the
+ * shared client, the lock 'buxton' must be held.
+ * returns 0 or ETIMEDOUT
+ */
+static inline int
+_wait_buxton_reader_ (const struct timespec *deadline)
+{
+  struct timespec abstime;
+  int ms;
+
+  if (deadline == NULL)
+    return pthread_cond_wait (&cond_buxton, &mutex_buxton);
+
+  ms = _remaining_ (deadline);
+  clock_gettime (CLOCK_REALTIME, &abstime);
+  abstime.tv_sec += ms / 1000;
+  abstime.tv_nsec += (long) (ms % 1000) * 1000000;
+  if (abstime.tv_nsec >= 1000000000)
     {
-      ERR ("Error while getting list of names from buxton");
-      data->cb_status = VCONF_ERROR;
-      return;
+      abstime.tv_sec++;
+      abstime.tv_nsec -= 1000000000;
     }
+  return pthread_cond_timedwait (&cond_buxton, &mutex_buxton, &abstime);
+}
+#endif
 
-  /*
-   * iterate on the list of names 
-   */
-  assert (data->directory[data->dirlen - 1] == '/');
-  keylist = data->keylist;
-  count = buxton_response_list_names_count (resp);
-  index = 0;
-  while (index < count)
+/*
+ * waits until 'deadline' for responses of the shared client whose
+ * 'generation' was recorded when sending the requests. The lock
+ * 'buxton' must be held, it is released while waiting so that other
+ * threads can send their requests. One thread at a time, the reader,
+ * polls the client. The others wait to be woken when responses are
+ * handled or when the reader leaves, one of them becoming the reader.
+ * The operation waiting counts its requests in 'sent' and its
+ * responses in 'received'. On timeout, the client is kept for the
+ * others and the operation gives up its awaited responses.
+ */
+static int
+_wait_shared_buxton_ (const unsigned *sent, const unsigned *received,
+		      unsigned generation, const struct timespec *deadline)
+{
+  struct pollfd pfd[2];
+  int status;
+  nfds_t count;
+#if !defined(NO_MULTITHREADING)
+  uint64_t value;
+
+  if (the_buxton_reader_is_active)
     {
-      /*
-       * get the name 
-       */
-      buxname = buxton_response_list_names_item (resp, index++);
-      if (buxname == NULL)
+      status = _wait_buxton_reader_ (deadline);
+      if (generation != the_buxton_client_generation)
+	return VCONF_ERROR;
+      if (status == ETIMEDOUT && *sent != *received)
 	{
-	  ERR ("Unexpected NULL name returned by buxton");
-	  data->cb_status = VCONF_ERROR;
-	  return;
+	  ERR ("Timeout while waiting buxton");
+	  return VCONF_ERROR_TIMEOUT;
 	}
+      return VCONF_OK;
+    }
+#endif
 
-      /*
-       * normalise the name 
-       */
-#if defined(REMOVE_PREFIXES)
-      length = asprintf (&name, "%s/%s", data->prefix, buxname);
-#else
-      length = asprintf (&name, "%s", buxname);
+  if (generation != the_buxton_client_generation)
+    return VCONF_ERROR;
+
+  pfd[0].fd = the_buxton_client_fd;
+  pfd[0].events = POLLIN;
+  pfd[0].revents = 0;
+  count = 1;
+#if !defined(NO_MULTITHREADING)
+  if (the_buxton_reader_wakeup >= 0)
+    {
+      pfd[1].fd = the_buxton_reader_wakeup;
+      pfd[1].events = POLLIN;
+      pfd[1].revents = 0;
+      count = 2;
+    }
+#endif
+  the_buxton_reader_is_active = 1;
+  UNLOCK (buxton);
+  STAT_INC (polls);
+  status = poll (pfd, count, _remaining_ (deadline));
+  LOCK (buxton);
+  the_buxton_reader_is_active = 0;
+  BROADCAST (buxton);
+#if !defined(NO_MULTITHREADING)
+  if (count > 1 && (pfd[1].revents & POLLIN))
+    {
+      if (read (the_buxton_reader_wakeup, &value, sizeof value) < 0)
+	ERR ("Can't read the wakeup event: %m");
+    }
 #endif
-      free (buxname);
-      if (length < 0)
-	{
-	  ERR ("Memory allocation error");
-	  data->cb_status = VCONF_ERROR;
-	  return;
-	}
-      assert (_check_keyname_ (name));
-      assert (!memcmp (data->directory, name, data->dirlen));
 
-      /*
-       * add key if requested 
-       */
-      term = strchr (name + data->dirlen, '/');
-      if (data->want_keys && (data->is_recursive || term == NULL))
+  if (generation != the_buxton_client_generation)
+    return VCONF_ERROR;
+  if (status < 0)
+    {
+      if (errno == EINTR)
+	return VCONF_OK;
+      ERR ("Can't poll buxton: %m");
+      _drop_buxton_ ();
+      return VCONF_ERROR;
+    }
+  if (status == 0)
+    {
+      if (*sent == *received)
+	return VCONF_OK;
+      ERR ("Timeout while waiting buxton");
+      return VCONF_ERROR_TIMEOUT;
+    }
+  if (pfd[0].revents & POLLIN)
+    return _handle_buxton_response_ (0) < 0 ? VCONF_ERROR : VCONF_OK;
+  if (pfd[0].revents)
+    {
+      _drop_buxton_ ();
+      return VCONF_ERROR;
+    }
+  return VCONF_OK;
+}
+
+/*================= SECTION connection pool =============*/
+
+/*
+ * The pool gives private connections to the operations on keylists so
+ * that the threads don't wait each other on the shared connection. The
+ * shared connection keeps the notifications and the cache. It is also
+ * used when the pool is disabled or when all its connections are busy.
+ */
+
+/*
+ * get a free connection of the pool or NULL
+ */
+static struct connection *
+_pool_acquire_ ()
+{
+  struct connection *result;
+  int create;
+
+  if (pool_size == 0)
+    return NULL;
+
+  create = 0;
+  LOCK (pool);
+  result = pool_free;
+  if (result != NULL)
+    pool_free = result->next;
+  else if (pool_count < pool_size)
+    {
+      pool_count++;
+      create = 1;
+    }
+  UNLOCK (pool);
+
+  if (create)
+    {
+      result = malloc (sizeof *result);
+      if (result != NULL)
 	{
-	  keynode = _keylist_getadd_ (keylist, name, type_unset);
-	  if (keynode == NULL)
+	  result->fd = buxton_open (&result->client);
+	  if (result->fd < 0)
 	    {
-	      free (name);
-	      data->cb_status = VCONF_ERROR;
-	      return;
+	      ERR ("can't connect to buxton server: %m");
+	      free (result);
+	      result = NULL;
 	    }
 	}
-
-      /*
-       * add directories if requested 
-       */
-      if (data->want_directories)
+      if (result == NULL)
 	{
-	  while (term != NULL)
-	    {
-	      *term = 0;
-	      keynode = _keylist_getadd_ (keylist, name, type_directory);
-	      if (keynode == NULL)
-		{
-		  free (name);
-		  data->cb_status = VCONF_ERROR;
-		  return;
-		}
-	      if (!data->is_recursive)
-		{
-		  break;
-		}
-	      *term = '/';
-	      term = strchr (term + 1, '/');
-	    }
+	  LOCK (pool);
+	  pool_count--;
+	  UNLOCK (pool);
 	}
+    }
+  return result;
+}
 
-      free (name);
+/*
+ * give back a connection to the pool. It is closed if 'broken' is set
+ * or if the pool was shrinked.
+ */
+static void
+_pool_release_ (struct connection *connection, int broken)
+{
+  LOCK (pool);
+  if (!broken && pool_count <= pool_size)
+    {
+      connection->next = pool_free;
+      pool_free = connection;
+      connection = NULL;
     }
-  data->cb_status = VCONF_OK;
+  else
+    pool_count--;
+  UNLOCK (pool);
+
+  if (connection != NULL)
+    {
+      buxton_close (connection->client);
+      free (connection);
+    }
+}
+
+/*
+ * waits until 'deadline' for responses on 'connection' and handles them
+ */
+static int
+_dispatch_connection_ (struct connection *connection,
+		       const struct timespec *deadline)
+{
+  int status;
+  ssize_t count;
+  struct pollfd pfd;
+
+  pfd.fd = connection->fd;
+  pfd.events = POLLIN;
+  for (;;)
+    {
+      pfd.revents = 0;
+      STAT_INC (polls);
+      status = poll (&pfd, 1, _remaining_ (deadline));
+      if (status == -1)
+	{
+	  if (errno != EINTR)
+	    return VCONF_ERROR;
+	}
+      else if (status == 0)
+	return VCONF_ERROR_TIMEOUT;
+      else if (pfd.revents & POLLIN)
+	{
+	  count = buxton_client_handle_response (connection->client);
+	  if (count > 0 || (count < 0 && errno == EAGAIN))
+	    return VCONF_OK;
+	  ERR ("Error in buxton_client_handle_response: %m");
+	  return VCONF_ERROR;
+	}
+      else
+	return VCONF_ERROR;
+    }
+}
+
+/*================= SECTION contexts =============*/
+
+/*
+ * A context owns a connection, a group, an error code and a cache. It is
+ * used by one thread at a time, so its members are accessed without locks.
+ */
+
+/*
+ * opens if needed the connection of 'ctx'. Returns 1 on success.
+ */
+static int
+_ctx_open_ (vconf_ctx_t * ctx)
+{
+  if (ctx->connection.client != NULL)
+    return 1;
+
+  ctx->connection.fd = buxton_open (&ctx->connection.client);
+  if (ctx->connection.fd >= 0)
+    return 1;
+
+  ERR ("can't connect to buxton server: %m");
+  ctx->connection.client = NULL;
+  return 0;
+}
+
+/*
+ * closes the connection of 'ctx' and forgets its cached values
+ */
+static void
+_ctx_drop_ (vconf_ctx_t * ctx)
+{
+  BuxtonClient client;
+
+  client = ctx->connection.client;
+  ctx->connection.client = NULL;
+  _cache_flush_ (&ctx->cache);
+  if (client != NULL)
+    buxton_close (client);
+}
+
+/*
+ * get the cache of values of 'ctx'
+ */
+static inline struct cache *
+_cache_of_ (vconf_ctx_t * ctx)
+{
+  return ctx != NULL ? &ctx->cache : &the_cache;
 }
 
+/*
+ * records the error code 'error' for 'keylist'
+ */
+static inline void
+_set_errno_ (keylist_t * keylist, int error)
+{
+  if (keylist->cb_ctx != NULL)
+    keylist->cb_ctx->error = error;
+  else
+    g_vconf_errno = error;
+}
 
 static inline int
-_async_set_ (keynode_t * keynode)
+_get_layer_key_ (const char *keyname, struct layer_key *laykey)
 {
-  void *data;
-  int status;
-  BuxtonKey key;
+  int i, j;
+  const char *prefix;
 
-  assert (keynode != NULL);
+  /*
+   * get the names 
+   */
+  i = 0;
+  prefix = assoc_prefix_layer[i][0];
+  while (prefix != NULL)
+    {
+      for (j = 0; prefix[j] && prefix[j] == keyname[j]; j++);
+      if (!prefix[j] && (!keyname[j] || keyname[j] == '/'))
+	{
+	  laykey->prefix = prefix;
+	  laykey->layer = assoc_prefix_layer[i][1];
+#if defined(REMOVE_PREFIXES)
+	  laykey->key = keyname + j + (keyname[j] == '/');
+#else
+	  laykey->key = keyname;
+#endif
+	  return VCONF_OK;
+	}
+      i++;
+      prefix = assoc_prefix_layer[i][0];
+    }
+  ERR ("Invalid argument: wrong prefix of key(%s)", keyname);
+  return VCONF_ERROR;
+}
 
-  switch (keynode->type)
+static inline BuxtonKey
+_create_buxton_key_ (const char *keyname, enum keytype keytype,
+		     const char *group)
+{
+  BuxtonDataType type;
+  struct layer_key laykey;
+
+  /*
+   * get layer and key 
+   */
+  if (_get_layer_key_ (keyname, &laykey) != VCONF_OK)
+    {
+      return NULL;
+    }
+
+  /*
+   * get type 
+   */
+  switch (keytype)
     {
     case type_string:
-      data = keynode->value.s;
+      type = BUXTON_TYPE_STRING;
       break;
     case type_int:
+      type = BUXTON_TYPE_INT32;
+      break;
     case type_double:
+      type = BUXTON_TYPE_DOUBLE;
+      break;
     case type_bool:
-      data = &keynode->value;
+      type = BUXTON_TYPE_BOOLEAN;
       break;
     default:
-      return 0;
+      type = BUXTON_TYPE_UNSET;
     }
 
-  key = _get_buxton_key_ (keynode);
-  if (key == NULL)
-    {
-      return -1;
-    }
+  return buxton_key_create (group, laykey.key, laykey.layer, type);
+}
 
-  status = buxton_set_value (_buxton_ (), key,
-			     data,
-			     (BuxtonCallback) _cb_inc_received_, keynode,
-			     false);
-  buxton_key_free (key);
+/*================= SECTION buxton keys =============*/
 
-  if (status == 0)
+/*
+ * The buxton keys are cached to avoid their creation at each call.
+ * The cache is bounded and the least recently used keys are released
+ * first. The entries are reference counted because a key can be used
+ * while it is evicted.
+ */
+
+static inline void
+_keycache_unlink_lru_ (struct keycache *entry)
+{
+  if (entry->newer)
+    entry->newer->older = entry->older;
+  else
+    keycache_newest = entry->older;
+  if (entry->older)
+    entry->older->newer = entry->newer;
+  else
+    keycache_oldest = entry->newer;
+}
+
+static inline void
+_keycache_link_lru_ (struct keycache *entry)
+{
+  entry->newer = NULL;
+  entry->older = keycache_newest;
+  if (keycache_newest)
+    keycache_newest->newer = entry;
+  else
+    keycache_oldest = entry;
+  keycache_newest = entry;
+}
+
+static inline void
+_keycache_free_ (struct keycache *entry)
+{
+  buxton_key_free (entry->key);
+  free (entry);
+}
+
+/*
+ * removes 'entry' from the cache, the lock 'keys' must be held
+ */
+static void
+_keycache_remove_ (struct keycache *entry)
+{
+  struct keycache **prev;
+
+  assert (entry->is_cached);
+
+  prev = &keycache_buckets[entry->hash & 255];
+  while (*prev != entry)
+    prev = &(*prev)->next;
+  *prev = entry->next;
+  _keycache_unlink_lru_ (entry);
+  entry->is_cached = 0;
+  keycache_count--;
+  if (entry->refcount == 0)
+    _keycache_free_ (entry);
+}
+
+/*
+ * removes all the entries of the cache, the lock 'keys' must be held
+ */
+static void
+_keycache_flush_ ()
+{
+  while (keycache_oldest != NULL)
+    _keycache_remove_ (keycache_oldest);
+}
+
+/*
+ * get the buxton key of 'keyname' for 'type'.
+ * The returned entry must be released using _put_buxton_key_.
+ */
+static struct keycache *
+_get_buxton_key_of_ (const char *keyname, enum keytype type)
+{
+  struct keycache *entry;
+  unsigned hash;
+  size_t length;
+  char *name;
+
+  hash = _hash_name_ (keyname);
+
+  LOCK (keys);
+  entry = keycache_buckets[hash & 255];
+  while (entry != NULL
+	 && (entry->hash != hash || entry->type != type
+	     || strcmp (entry->keyname, keyname)))
+    entry = entry->next;
+  if (entry != NULL)
+    {
+      entry->refcount++;
+      if (entry->newer != NULL)
+	{
+	  _keycache_unlink_lru_ (entry);
+	  _keycache_link_lru_ (entry);
+	}
+      UNLOCK (keys);
+      return entry;
+    }
+
+  /*
+   * not found, create it 
+   */
+  length = strlen (keyname);
+  entry = malloc (1 + length + sizeof *entry);
+  if (entry == NULL)
+    {
+      UNLOCK (keys);
+      ERR ("Can't allocate memory for the buxton key");
+      return NULL;
+    }
+  LOCK (group);
+  entry->key = _create_buxton_key_ (keyname, type, default_group);
+  UNLOCK (group);
+  if (entry->key == NULL)
+    {
+      UNLOCK (keys);
+      free (entry);
+      return NULL;
+    }
+  STAT_INC (keys_created);
+  name = (char *) (entry + 1);
+  memcpy (name, keyname, length + 1);
+  entry->keyname = name;
+  entry->hash = hash;
+  entry->type = type;
+  entry->refcount = 1;
+
+  /*
+   * evict the least recently used unreferenced entries 
+   */
+  while (keycache_count >= keycache_maximum_count)
+    {
+      struct keycache *older = keycache_oldest;
+      while (older != NULL && older->refcount != 0)
+	older = older->newer;
+      if (older == NULL)
+	break;
+      _keycache_remove_ (older);
+    }
+
+  entry->is_cached = keycache_count < keycache_maximum_count;
+  if (entry->is_cached)
+    {
+      entry->next = keycache_buckets[hash & 255];
+      keycache_buckets[hash & 255] = entry;
+      _keycache_link_lru_ (entry);
+      keycache_count++;
+    }
+  UNLOCK (keys);
+  return entry;
+}
+
+static void
+_release_buxton_key_ (struct keycache *entry)
+{
+  LOCK (keys);
+  if (--entry->refcount == 0 && !entry->is_cached)
+    _keycache_free_ (entry);
+  UNLOCK (keys);
+}
+
+/*
+ * get the buxton key of 'keyname' for 'type' in the group of 'ctx'.
+ * The keys of the contexts aren't cached.
+ * The returned entry must be released using _release_buxton_key_.
+ */
+static struct keycache *
+_get_buxton_key_in_ (vconf_ctx_t * ctx, const char *keyname,
+		     enum keytype type)
+{
+  struct keycache *entry;
+
+  if (ctx == NULL)
+    return _get_buxton_key_of_ (keyname, type);
+
+  entry = calloc (1, sizeof *entry);
+  retvm_if (entry == NULL, NULL, "Can't allocate memory for the buxton key");
+  entry->key = _create_buxton_key_ (keyname, type, ctx->group);
+  if (entry->key == NULL)
+    {
+      free (entry);
+      return NULL;
+    }
+  STAT_INC (keys_created);
+  entry->keyname = keyname;
+  entry->type = type;
+  entry->refcount = 1;
+  return entry;
+}
+
+/*
+ * get the buxton key of 'node'. The prepared keys of the list are used
+ * without taking any reference, except in contexts because they are
+ * bound to the default group.
+ */
+static inline struct keycache *
+_get_buxton_key_ (keynode_t * node)
+{
+  struct keycache **keys = node->list->keys;
+
+  if (keys != NULL && keys[node->type] != NULL && node->list->cb_ctx == NULL)
+    return keys[node->type];
+  return _get_buxton_key_in_ (node->list->cb_ctx, node->keyname, node->type);
+}
+
+static inline void
+_put_buxton_key_ (keynode_t * node, struct keycache *entry)
+{
+  if (node->list->keys == NULL || node->list->keys[node->type] != entry)
+    _release_buxton_key_ (entry);
+}
+
+/*================= SECTION set/unset/refresh =============*/
+
+/*
+ * counts a response for 'list' and, when it was the last awaited one,
+ * queues the continuation of its asynchronous operation
+ */
+static inline void
+_keylist_received_ (keylist_t * list)
+{
+  list->cb_received++;
+  if (list->cb_async != NULL && list->cb_received == list->cb_sent)
+    _event_push_ (&event_queue, &list->cb_async->event);
+}
+
+static void
+_cb_inc_received_ (BuxtonResponse resp, keynode_t * keynode)
+{
+  keylist_t *list;
+
+  assert (keynode != NULL);
+  assert (keynode->list != NULL);
+
+  list = keynode->list;
+  _keylist_received_ (list);
+  _set_errno_ (list, buxton_response_status (resp));
+  if (buxton_response_status (resp) != 0)
+    {
+      ERR ("Buxton returned error %d for key %s",
+	   buxton_response_status (resp), keynode->keyname);
+      list->cb_status = VCONF_ERROR;
+      keynode->status = VCONF_ERROR;
+    }
+  else
+    keynode->status = VCONF_OK;
+}
+
+/*
+ * callback of the requests of the shared client, ignoring the given up
+ * responses
+ */
+static void
+_cb_shared_inc_received_ (BuxtonResponse resp, keynode_t * keynode)
+{
+  if (!_orphan_take_ (keynode))
+    _cb_inc_received_ (resp, keynode);
+}
+
+/*
+ * the callback for the requests of 'keynode' counting its response
+ */
+static inline BuxtonCallback
+_cb_inc_of_ (keynode_t * keynode)
+{
+  return (BuxtonCallback) (keynode->list->cb_shared ?
+			   _cb_shared_inc_received_ : _cb_inc_received_);
+}
+
+static int
+_set_response_to_keynode_ (BuxtonResponse resp, keynode_t * keynode,
+			   int force)
+{
+  enum keytype type;
+  BuxtonDataType buxtyp;
+  void *buxval;
+  size_t length;
+
+  assert (keynode != NULL);
+  assert (buxton_response_status (resp) == 0);
+
+  buxtyp = buxton_response_value_type (resp);
+  switch (buxtyp)
+    {
+    case BUXTON_TYPE_STRING:
+      type = type_string;
+      break;
+    case BUXTON_TYPE_INT32:
+      type = type_int;
+      break;
+    case BUXTON_TYPE_DOUBLE:
+      type = type_double;
+      break;
+    case BUXTON_TYPE_BOOLEAN:
+      type = type_bool;
+      break;
+    default:
+      return VCONF_ERROR;
+    }
+
+  if (force && type != keynode->type && keynode->type != type_unset)
+    return VCONF_ERROR;
+
+  buxval = buxton_response_value (resp);
+  if (buxval == NULL)
+    return VCONF_ERROR;
+
+  _keynode_free_string_ (keynode);
+
+  keynode->type = type;
+  switch (type)
+    {
+    case type_string:
+      if (!_keynode_is_arena_ (keynode))
+	{
+	  keynode->value.s = buxval;
+	  return VCONF_OK;
+	}
+      length = 1 + strlen (buxval);
+      keynode->value.s = _arena_alloc_ (&keynode->list->arena, length);
+      if (keynode->value.s == NULL)
+	{
+	  keynode->type = type_unset;
+	  free (buxval);
+	  return VCONF_ERROR;
+	}
+      memcpy (keynode->value.s, buxval, length);
+      break;
+    case type_int:
+      keynode->value.i = (int) *(int32_t *) buxval;
+      break;
+    case type_double:
+      keynode->value.d = *(double *) buxval;
+      break;
+    case type_bool:
+      keynode->value.b = *(bool *) buxval;
+      break;
+    default:
+      assert (0);
+      break;
+    }
+  free (buxval);
+  return VCONF_OK;
+}
+
+static void
+_cb_refresh_ (BuxtonResponse resp, keynode_t * keynode)
+{
+  keylist_t *list;
+
+  assert (keynode != NULL);
+  assert (keynode->list != NULL);
+  assert (buxton_response_type (resp) == BUXTON_CONTROL_GET);
+
+  list = keynode->list;
+  _keylist_received_ (list);
+  _set_errno_ (list, buxton_response_status (resp));
+  if (buxton_response_status (resp) != 0)
+    {
+      ERR ("Error %d while getting buxton key %s",
+	   buxton_response_status (resp), keynode->keyname);
+      list->cb_status = VCONF_ERROR;
+      keynode->status = VCONF_ERROR;
+    }
+  else if (_set_response_to_keynode_ (resp, keynode, 0) != VCONF_OK)
+    {
+      list->cb_status = VCONF_ERROR;
+      keynode->status = VCONF_ERROR;
+    }
+  else
+    keynode->status = VCONF_OK;
+}
+
+/*
+ * callback of the gets of the shared client, ignoring the given up
+ * responses
+ */
+static void
+_cb_shared_refresh_ (BuxtonResponse resp, keynode_t * keynode)
+{
+  if (!_orphan_take_ (keynode))
+    _cb_refresh_ (resp, keynode);
+}
+
+static void
+_cb_scan_ (BuxtonResponse resp, struct scanning_data *data)
+{
+  char *buxname;
+  char *name;
+  char *term;
+  uint32_t count;
+  uint32_t index;
+  keylist_t *keylist;
+  keynode_t *keynode;
+  int length;
+
+  /*
+   * ignore the response of a given up scan 
+   */
+  if (_orphan_take_ (data))
+    return;
+
+  data->received++;
+
+  /*
+   * check the response status 
+   */
+  if ((g_vconf_errno = buxton_response_status (resp)) != 0)
+    {
+      ERR ("Error while getting list of names from buxton");
+      data->cb_status = VCONF_ERROR;
+      return;
+    }
+
+  /*
+   * iterate on the list of names 
+   */
+  assert (data->directory[data->dirlen - 1] == '/');
+  keylist = data->keylist;
+  count = buxton_response_list_names_count (resp);
+  index = 0;
+  while (index < count)
+    {
+      /*
+       * get the name 
+       */
+      buxname = buxton_response_list_names_item (resp, index++);
+      if (buxname == NULL)
+	{
+	  ERR ("Unexpected NULL name returned by buxton");
+	  data->cb_status = VCONF_ERROR;
+	  return;
+	}
+
+      /*
+       * normalise the name 
+       */
+#if defined(REMOVE_PREFIXES)
+      length = asprintf (&name, "%s/%s", data->prefix, buxname);
+#else
+      length = asprintf (&name, "%s", buxname);
+#endif
+      free (buxname);
+      if (length < 0)
+	{
+	  ERR ("Memory allocation error");
+	  data->cb_status = VCONF_ERROR;
+	  return;
+	}
+      assert (_check_keyname_ (name));
+      assert (!memcmp (data->directory, name, data->dirlen));
+
+      /*
+       * add key if requested 
+       */
+      term = strchr (name + data->dirlen, '/');
+      if (data->want_keys && (data->is_recursive || term == NULL))
+	{
+	  keynode = _keylist_getadd_ (keylist, name, type_unset);
+	  if (keynode == NULL)
+	    {
+	      free (name);
+	      data->cb_status = VCONF_ERROR;
+	      return;
+	    }
+	}
+
+      /*
+       * add directories if requested 
+       */
+      if (data->want_directories)
+	{
+	  while (term != NULL)
+	    {
+	      *term = 0;
+	      keynode = _keylist_getadd_ (keylist, name, type_directory);
+	      if (keynode == NULL)
+		{
+		  free (name);
+		  data->cb_status = VCONF_ERROR;
+		  return;
+		}
+	      if (!data->is_recursive)
+		{
+		  break;
+		}
+	      *term = '/';
+	      term = strchr (term + 1, '/');
+	    }
+	}
+
+      free (name);
+    }
+  data->cb_status = VCONF_OK;
+}
+
+
+static inline int
+_async_set_ (keynode_t * keynode)
+{
+  void *data;
+  int status;
+  struct keycache *key;
+
+  assert (keynode != NULL);
+
+  switch (keynode->type)
+    {
+    case type_string:
+      data = keynode->value.s;
+      break;
+    case type_int:
+    case type_double:
+    case type_bool:
+      data = &keynode->value;
+      break;
+    default:
+      return 0;
+    }
+
+  key = _get_buxton_key_ (keynode);
+  if (key == NULL)
+    {
+      return -1;
+    }
+
+  status = buxton_set_value (keynode->list->cb_client, key->key,
+			     data, _cb_inc_of_ (keynode), keynode, false);
+  _put_buxton_key_ (keynode, key);
+
+  if (status == 0)
+    {
+      return 1;
+    }
+
+  ERR ("Error while calling buxton_set_value: %m");
+  return -1;
+}
+
+static inline int
+_async_unset_ (keynode_t * keynode)
+{
+  int status;
+  struct keycache *key;
+
+  assert (keynode != NULL);
+
+  if (keynode->type != type_delete)
+    {
+      return 0;
+    }
+
+  key = _get_buxton_key_ (keynode);
+  if (key == NULL)
+    {
+      return -1;
+    }
+
+  status = buxton_unset_value (keynode->list->cb_client, key->key,
+			       _cb_inc_of_ (keynode), keynode, false);
+  _put_buxton_key_ (keynode, key);
+
+  if (status == 0)
+    {
+      return 1;
+    }
+
+  ERR ("Error while calling buxton_unset_value: %m");
+  return -1;
+}
+
+static inline int
+_async_set_or_unset_ (keynode_t * keynode, const char *unused)
+{
+  assert (keynode != NULL);
+
+  switch (keynode->type)
+    {
+    case type_unset:
+    case type_directory:
+      return 0;
+    case type_delete:
+      return _async_unset_ (keynode);
+    default:
+      return _async_set_ (keynode);
+    }
+}
+
+static inline int
+_async_refresh_ (keynode_t * keynode, const char *unused)
+{
+  int status;
+  struct keycache *key;
+
+  assert (keynode != NULL);
+
+  switch (keynode->type)
+    {
+    case type_unset:
+    case type_string:
+    case type_int:
+    case type_double:
+    case type_bool:
+      break;
+    default:
+      return 0;
+    }
+
+  key = _get_buxton_key_ (keynode);
+  if (key == NULL)
+    {
+      return -1;
+    }
+
+  status = buxton_get_value (keynode->list->cb_client, key->key,
+			     (BuxtonCallback) (keynode->list->cb_shared ?
+					       _cb_shared_refresh_ :
+					       _cb_refresh_), keynode, false);
+  _put_buxton_key_ (keynode, key);
+
+  if (status == 0)
+    {
+      return 1;
+    }
+
+  ERR ("Error while calling buxton_get_value: %m");
+  return -1;
+}
+
+static inline int
+_async_set_label_ (keynode_t * keynode, const char *label)
+{
+  int status;
+  struct keycache *key;
+
+  assert (keynode != NULL);
+
+  key = _get_buxton_key_ (keynode);
+  if (key == NULL)
+    {
+      return -1;
+    }
+
+  status = buxton_set_label (keynode->list->cb_client, key->key, label,
+			     _cb_inc_of_ (keynode), keynode, false);
+  _put_buxton_key_ (keynode, key);
+
+  if (status == 0)
+    {
+      return 1;
+    }
+
+  ERR ("Error while calling buxton_set_label: %m");
+  return -1;
+}
+
+
+/*
+ * sets the status of all the keys of 'keylist' to VCONF_ERROR
+ */
+static inline void
+_keylist_set_error_ (keylist_t * keylist)
+{
+  keynode_t *keynode;
+
+  for (keynode = keylist->head; keynode != NULL; keynode = keynode->next)
+    keynode->status = VCONF_ERROR;
+}
+
+/*
+ * gives up the responses still awaited by the keys of 'keylist', setting
+ * their status to VCONF_ERROR. Their responses are ignored when 'shared'
+ * tells that they will come on the living shared client, the lock
+ * 'buxton' being held. Returns 0 or -1 if they can't be ignored.
+ */
+static int
+_keylist_give_up_ (keylist_t * keylist, int shared)
+{
+  keynode_t *keynode;
+  int status;
+
+  status = 0;
+  for (keynode = keylist->head; keynode != NULL; keynode = keynode->next)
+    if (keynode->status == KEYNODE_PENDING)
+      {
+	keynode->status = VCONF_ERROR;
+	if (shared && status == 0)
+	  status = _orphan_add_ (keynode);
+      }
+  return status;
+}
+
+/*
+ * applies 'async' to the keys of 'keylist' using the connection of 'ctx'
+ * or, when 'ctx' is NULL, a connection of the pool or the shared one.
+ * 'shared' forces the use of the shared one.
+ */
+static int
+_apply_buxton_on_list_ (vconf_ctx_t * ctx, keylist_t * keylist,
+			int (*async) (keynode_t *, const char *),
+			const char *data, int shared,
+			const struct timespec *deadline)
+{
+  keynode_t *keynode;
+  int status;
+  int sent;
+  int broken;
+  unsigned generation;
+  struct connection *connection;
+  struct timespec now;
+
+  assert (keylist != NULL);
+
+  retvm_if (keylist->cb_active != 0, VCONF_ERROR,
+	    "Already active in vconf-buxton");
+
+  if (ctx != NULL)
+    {
+      if (!_ctx_open_ (ctx))
+	{
+	  _keylist_set_error_ (keylist);
+	  return VCONF_ERROR;
+	}
+      connection = &ctx->connection;
+    }
+  else
+    connection = shared ? NULL : _pool_acquire_ ();
+  if (connection == NULL)
+    {
+      status = _open_buxton_ ();
+      if (!status)
+	{
+	  _keylist_set_error_ (keylist);
+	  ERR ("Can't connect to buxton");
+	  return VCONF_ERROR;
+	}
+      LOCK (buxton);
+      if (the_buxton_client == NULL)
+	{
+	  UNLOCK (buxton);
+	  _keylist_set_error_ (keylist);
+	  ERR ("Connection to buxton lost");
+	  return VCONF_ERROR;
+	}
+      the_buxton_client_users++;
+    }
+
+  generation = the_buxton_client_generation;
+  keylist->cb_client = connection ? connection->client : the_buxton_client;
+  keylist->cb_shared = connection == NULL;
+  keylist->cb_ctx = ctx;
+  keylist->cb_active = 1;
+  keylist->cb_status = VCONF_OK;
+  keylist->cb_sent = 0;
+  keylist->cb_received = 0;
+
+  /*
+   * The requests are sent back to back as long as fewer than
+   * 'pipeline_window' of them are waiting for their response. Then the
+   * responses are received as they arrive, each wakeup handling the
+   * response received and reopening the window. The window also
+   * bounds the data pending in the socket so that sending never blocks
+   * on a server blocked by unread responses.
+   * On the shared client, the lock 'buxton' is released while waiting
+   * so that the requests of several threads are multiplexed.
+   */
+  keynode = keylist->head;
+  if (connection == NULL)
+    status = _sync_buxton_ (0);
+  else if (_dispatch_connection_ (connection, _deadline_ (&now, 0))
+	   == VCONF_ERROR)
+    status = VCONF_ERROR;
+  else
+    status = VCONF_OK;
+  while (status == VCONF_OK)
+    {
+      while (keynode != NULL
+	     && keylist->cb_sent - keylist->cb_received < pipeline_window)
+	{
+	  /*
+	   * the status of the key is set by its response 
+	   */
+	  sent = async (keynode, data);
+	  keynode->status = sent > 0 ? KEYNODE_PENDING
+	    : sent < 0 ? VCONF_ERROR : VCONF_OK;
+	  keynode = keynode->next;
+	  if (sent < 0)
+	    {
+	      status = VCONF_ERROR;
+	      break;
+	    }
+	  if (sent > 0)
+	    {
+	      keylist->cb_sent += sent;
+	      STAT_INC (requests);
+	    }
+	}
+      if (status != VCONF_OK || keylist->cb_sent == keylist->cb_received)
+	{
+	  if (keynode == NULL)
+	    break;
+	}
+      else if (connection == NULL)
+	status = _wait_shared_buxton_ (&keylist->cb_sent, &keylist->cb_received,
+				       generation, deadline);
+      else
+	status = _dispatch_connection_ (connection, deadline);
+    }
+  for (; keynode != NULL; keynode = keynode->next)
+    keynode->status = VCONF_ERROR;
+
+  /*
+   * a failed operation gives up its awaited responses. The pool and the
+   * contexts close their broken connection but the shared client is
+   * kept for the other users and ignores them.
+   */
+  if (keylist->cb_sent != keylist->cb_received
+      && _keylist_give_up_ (keylist, connection == NULL
+			    && generation == the_buxton_client_generation)
+      && the_buxton_client != NULL)
+    _drop_buxton_ ();
+
+  broken = status != VCONF_OK;
+  if (status == VCONF_OK && keylist->cb_status != VCONF_OK)
+    status = keylist->cb_status;
+  keylist->cb_active = 0;
+  keylist->cb_client = NULL;
+  keylist->cb_shared = 0;
+  keylist->cb_ctx = NULL;
+
+  if (ctx != NULL)
+    {
+      if (broken)
+	_ctx_drop_ (ctx);
+      return status;
+    }
+
+  if (connection != NULL)
+    {
+      _pool_release_ (connection, broken);
+      return status;
+    }
+
+  the_buxton_client_users--;
+  UNLOCK (buxton);
+
+  _check_close_buxton_ ();
+  _deliver_events_ ();
+
+  return status;
+}
+
+/*
+ * The asynchronous operations use the shared client without waiting.
+ * They send the requests of a window of keys; the response completing
+ * the window queues the event of the operation that either sends the
+ * next window or, at the end, calls the completion callback. These
+ * events are delivered like the changes, by the glib source, the fd
+ * API or the calls handling responses.
+ */
+
+/*
+ * sends the requests of the next keys of 'async' while the window
+ * allows it, the lock 'buxton' must be held
+ */
+static void
+_async_send_ (struct async *async)
+{
+  keylist_t *keylist;
+  keynode_t *keynode;
+  int sent;
+
+  keylist = async->keylist;
+  while (async->keynode != NULL
+	 && keylist->cb_sent - keylist->cb_received < pipeline_window)
+    {
+      keynode = async->keynode;
+      async->keynode = keynode->next;
+      sent = async->request (keynode, NULL);
+      keynode->status = sent > 0 ? KEYNODE_PENDING
+	: sent < 0 ? VCONF_ERROR : VCONF_OK;
+      if (sent < 0)
+	{
+	  keylist->cb_status = VCONF_ERROR;
+	  for (keynode = async->keynode; keynode != NULL;
+	       keynode = keynode->next)
+	    keynode->status = VCONF_ERROR;
+	  async->keynode = NULL;
+	}
+      else if (sent > 0)
+	{
+	  keylist->cb_sent += sent;
+	  STAT_INC (requests);
+	}
+    }
+}
+
+/*
+ * continues the operation 'async' after its awaited responses:
+ * sends its next requests or completes it. No lock must be held.
+ */
+static void
+_async_continue_ (struct async *async)
+{
+  struct async **prev;
+  keylist_t *keylist;
+  keynode_t *keynode;
+  int status;
+
+  keylist = async->keylist;
+  LOCK (buxton);
+  if (async->keynode != NULL)
+    {
+      if (async->generation == the_buxton_client_generation)
+	{
+	  _async_send_ (async);
+	  if (keylist->cb_sent != keylist->cb_received)
+	    {
+	      UNLOCK (buxton);
+	      return;
+	    }
+	}
+      else
+	{
+	  keylist->cb_status = VCONF_ERROR;
+	  for (keynode = async->keynode; keynode != NULL;
+	       keynode = keynode->next)
+	    keynode->status = VCONF_ERROR;
+	}
+    }
+  for (prev = &async_pending; *prev != async; prev = &(*prev)->next);
+  *prev = async->next;
+  the_buxton_client_users--;
+  UNLOCK (buxton);
+
+  status = keylist->cb_status;
+  keylist->cb_active = 0;
+  keylist->cb_client = NULL;
+  keylist->cb_shared = 0;
+  keylist->cb_async = NULL;
+  if (async->is_set)
+    {
+      _cache_put_list_ (&the_cache, keylist);
+      _prefix_catch_ (keylist);
+    }
+  if (async->done != NULL)
+    async->done (keylist, status, async->userdata);
+  free (async);
+  _check_close_buxton_ ();
+}
+
+/*
+ * starts the asynchronous operation of 'request' on 'keylist'
+ */
+static int
+_apply_async_ (keylist_t * keylist,
+	       int (*request) (keynode_t *, const char *), int is_set,
+	       vconf_done_fn done, void *userdata)
+{
+  struct async *async;
+  int status;
+
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+  retvm_if (keylist->cb_active != 0, VCONF_ERROR,
+	    "Already active in vconf-buxton");
+
+  status = _open_buxton_ ();
+  retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
+#if !defined(NO_GLIB)
+  _glib_start_watch_ ();
+#endif
+
+  async = calloc (1, sizeof *async);
+  retvm_if (async == NULL, VCONF_ERROR, "Allocation of operation failed");
+  async->keylist = keylist;
+  async->request = request;
+  async->keynode = keylist->head;
+  async->is_set = is_set;
+  async->done = done;
+  async->userdata = userdata;
+  async->event.async = async;
+
+  LOCK (buxton);
+  if (the_buxton_client == NULL)
+    {
+      UNLOCK (buxton);
+      free (async);
+      ERR ("Connection to buxton lost");
+      return VCONF_ERROR;
+    }
+  the_buxton_client_users++;
+  async->generation = the_buxton_client_generation;
+  async->next = async_pending;
+  async_pending = async;
+  keylist->cb_client = the_buxton_client;
+  keylist->cb_shared = 1;
+  keylist->cb_ctx = NULL;
+  keylist->cb_async = async;
+  keylist->cb_active = 1;
+  keylist->cb_status = VCONF_OK;
+  keylist->cb_sent = 0;
+  keylist->cb_received = 0;
+  _async_send_ (async);
+  status = keylist->cb_sent == keylist->cb_received;
+  if (status)
+    _event_push_ (&event_queue, &async->event);
+  UNLOCK (buxton);
+
+  /*
+   * without request, the operation is completed now 
+   */
+  if (status)
+    _deliver_events_ ();
+  return VCONF_OK;
+}
+
+/*================= SECTION notification =============*/
+
+/*
+ * The watched keys are recorded in a hash table protected by the lock
+ * 'notify'. The notifications of a key are kept in an array that is
+ * copied on each change, so that readers only need to load the current
+ * array. The removed objects are retired and freed only when no reader
+ * is active (see _notify_read_begin_ and _notify_read_end_).
+ */
+
+/*
+ * frees the retired objects if no reader is active.
+ * the lock 'notify' must be held.
+ */
+static void
+_notify_reclaim_ ()
+{
+  struct notify *notif;
+  struct notify_set *set;
+  struct watch *watch;
+  struct batch *batch;
+
+  if (__sync_add_and_fetch (&notify_readers, 0) != 0)
+    return;
+
+  while ((notif = retired_notifies) != NULL)
+    {
+      retired_notifies = notif->next;
+#if !defined(NO_GLIB)
+      _loop_release_ (notif->loop);
+#endif
+      free (notif);
+    }
+  while ((set = retired_sets) != NULL)
+    {
+      retired_sets = set->next;
+      free (set);
+    }
+  while ((watch = retired_watches) != NULL)
+    {
+      retired_watches = watch->next;
+      _keynode_free_string_ (&watch->node);
+      free (watch);
+    }
+  while ((batch = retired_batches) != NULL)
+    {
+      retired_batches = batch->next;
+      free (batch);
+    }
+}
+
+/*
+ * enter a section using notifications without the lock 'notify'
+ */
+static inline void
+_notify_read_begin_ ()
+{
+  __sync_add_and_fetch (&notify_readers, 1);
+}
+
+/*
+ * leave a section using notifications without the lock 'notify'.
+ * The last reader frees the retired objects unless a writer is busy.
+ */
+static inline void
+_notify_read_end_ ()
+{
+  if (__sync_sub_and_fetch (&notify_readers, 1) == 0
+      && (retired_notifies != NULL || retired_sets != NULL
+	  || retired_watches != NULL || retired_batches != NULL)
+      && TRYLOCK (notify) == 0)
+    {
+      _notify_reclaim_ ();
+      UNLOCK (notify);
+    }
+}
+
+/*
+ * get the watch of 'keyname' or NULL, the lock 'notify' must be held
+ */
+static inline struct watch *
+_watch_lookup_ (const char *keyname, unsigned hash)
+{
+  struct watch *watch;
+
+  if (watch_buckets == NULL)
+    return NULL;
+
+  watch = watch_buckets[hash & (watch_bucket_count - 1)];
+  while (watch != NULL
+	 && (watch->hash != hash || strcmp (watch->node.keyname, keyname)))
+    watch = watch->next;
+  return watch;
+}
+
+/*
+ * get the watch of 'keyname', creating it if needed.
+ * the lock 'notify' must be held.
+ */
+static struct watch *
+_watch_get_ (const char *keyname)
+{
+  struct watch *watch, **buckets, *next;
+  unsigned hash, count, index;
+  size_t length;
+  char *name;
+
+  hash = _hash_name_ (keyname);
+  watch = _watch_lookup_ (keyname, hash);
+  if (watch != NULL)
+    return watch;
+
+  /*
+   * grow the table to keep the buckets short 
+   */
+  if (watch_count >= watch_bucket_count)
+    {
+      count = watch_bucket_count ? watch_bucket_count << 1 : 16;
+      buckets = calloc (count, sizeof *buckets);
+      if (buckets != NULL)
+	{
+	  for (index = 0; index < watch_bucket_count; index++)
+	    for (watch = watch_buckets[index]; watch != NULL; watch = next)
+	      {
+		next = watch->next;
+		watch->next = buckets[watch->hash & (count - 1)];
+		buckets[watch->hash & (count - 1)] = watch;
+	      }
+	  free (watch_buckets);
+	  watch_buckets = buckets;
+	  watch_bucket_count = count;
+	}
+      else if (watch_buckets == NULL)
+	{
+	  ERR ("Allocation of the watches failed");
+	  return NULL;
+	}
+    }
+
+  length = strlen (keyname);
+  watch = calloc (1, 1 + length + sizeof *watch);
+  retvm_if (watch == NULL, NULL, "Allocation of watch failed");
+  name = (char *) (watch + 1);
+  memcpy (name, keyname, length + 1);
+  watch->node.keyname = name;
+  watch->node.type = type_unset;
+  watch->hash = hash;
+  watch->next = watch_buckets[hash & (watch_bucket_count - 1)];
+  watch_buckets[hash & (watch_bucket_count - 1)] = watch;
+  watch_count++;
+  return watch;
+}
+
+/*
+ * removes 'watch' from the registry. It is freed at once if it never had
+ * notifications or is retired otherwise. the lock 'notify' must be held.
+ */
+static void
+_watch_remove_ (struct watch *watch, int retire)
+{
+  struct watch **prev;
+
+  prev = &watch_buckets[watch->hash & (watch_bucket_count - 1)];
+  while (*prev != watch)
+    prev = &(*prev)->next;
+  *prev = watch->next;
+  watch_count--;
+
+  if (retire)
+    {
+      watch->next = retired_watches;
+      retired_watches = watch;
+    }
+  else
+    {
+      _keynode_free_string_ (&watch->node);
+      free (watch);
+    }
+}
+
+/*
+ * replaces the notifications of 'watch' by 'set' and retires the
+ * previous array. the lock 'notify' must be held.
+ */
+static void
+_watch_publish_ (struct watch *watch, struct notify_set *set)
+{
+  struct notify_set *old;
+
+  old = watch->set;
+  __atomic_store_n (&watch->set, set, __ATOMIC_SEQ_CST);
+  if (old != NULL)
+    {
+      old->next = retired_sets;
+      retired_sets = old;
+    }
+}
+
+/*
+ * adds 'notif' to the notifications of 'watch'.
+ * the lock 'notify' must be held.
+ */
+static int
+_watch_add_ (struct watch *watch, struct notify *notif)
+{
+  struct notify_set *set, *old;
+  unsigned count;
+
+  old = watch->set;
+  count = old != NULL ? old->count : 0;
+  set = malloc (sizeof *set + (count + 1) * sizeof *set->items);
+  retvm_if (set == NULL, VCONF_ERROR, "Allocation of notify set failed");
+  if (count != 0)
+    memcpy (set->items, old->items, count * sizeof *set->items);
+  set->items[count] = notif;
+  set->count = count + 1;
+  _watch_publish_ (watch, set);
+  return VCONF_OK;
+}
+
+/*
+ * removes from 'watch' the notifications of 'callback' added for 'prefix'
+ * and 'batch' and returns them linked or NULL if none.
+ * the lock 'notify' must be held.
+ */
+static struct notify *
+_watch_del_ (struct watch *watch, vconf_callback_fn callback,
+	     struct prefix *prefix, struct batch *batch)
+{
+  struct notify_set *set, *old;
+  struct notify *removed, **prev;
+  unsigned index, count;
+
+  old = watch->set;
+  if (old == NULL)
+    return NULL;
+
+  count = 0;
+  for (index = 0; index < old->count; index++)
+    count += old->items[index]->callback != callback
+      || old->items[index]->prefix != prefix
+      || old->items[index]->batch != batch;
+  if (count == old->count)
+    return NULL;
+
+  set = NULL;
+  if (count != 0)
+    {
+      set = malloc (sizeof *set + count * sizeof *set->items);
+      retvm_if (set == NULL, NULL, "Allocation of notify set failed");
+      set->count = 0;
+    }
+
+  removed = NULL;
+  prev = &removed;
+  for (index = 0; index < old->count; index++)
+    if (old->items[index]->callback != callback
+	|| old->items[index]->prefix != prefix
+	|| old->items[index]->batch != batch)
+      set->items[set->count++] = old->items[index];
+    else
+      {
+	*prev = old->items[index];
+	(*prev)->removed = 1;
+	prev = &(*prev)->next;
+      }
+  *prev = NULL;
+
+  _watch_publish_ (watch, set);
+  return removed;
+}
+
+/*
+ * The changes are queued by _cb_notify_ while the responses are handled
+ * and delivered to the callbacks after the pass, without any lock held.
+ * The queue is a lock-free stack pushed by the threads handling the
+ * responses and emptied at once by the delivering thread. A queued event
+ * counts as a reader so that its notification and its watch stay valid.
+ */
+
+/*
+ * queues 'event' in 'queue' without lock
+ */
+static inline void
+_event_push_ (struct event **queue, struct event *event)
+{
+  struct event *head;
+
+  do
+    {
+      head = *queue;
+      event->next = head;
+    }
+  while (!__sync_bool_compare_and_swap (queue, head, event));
+}
+
+/*
+ * empties 'queue' and returns its events in their order of arrival
+ */
+static inline struct event *
+_event_take_ (struct event **queue)
+{
+  struct event *list, *event, *next;
+
+  list = __atomic_exchange_n (queue, NULL, __ATOMIC_ACQUIRE);
+  event = NULL;
+  while (list != NULL)
+    {
+      next = list->next;
+      list->next = event;
+      event = list;
+      list = next;
+    }
+  return event;
+}
+
+/*
+ * calls the callback of 'event' unless removed and frees it
+ */
+static void
+_event_run_ (struct event *event)
+{
+  if (!__atomic_load_n (&event->notif->removed, __ATOMIC_ACQUIRE))
+    event->notif->callback (&event->node, event->notif->userdata);
+  _keynode_free_string_ (&event->node);
+  free (event);
+  _notify_read_end_ ();
+}
+
+/*
+ * frees 'event' without calling its callback
+ */
+static void
+_event_drop_ (struct event *event)
+{
+  _keynode_free_string_ (&event->node);
+  free (event);
+  _notify_read_end_ ();
+}
+
+#if !defined(NO_MULTITHREADING)
+/*
+ * When workers are started, the delivering thread hands the events to
+ * them. The events of a watch are queued on the watch and the watch is
+ * queued once in the ready list: a worker takes the first ready watch,
+ * runs its first event and queues it again if it has more events. So the
+ * events of a key are run in order by one worker at a time while the
+ * other keys are run by the other workers.
+ */
+
+/*
+ * appends 'watch' to the ready list, the lock 'workers' must be held
+ */
+static inline void
+_worker_ready_ (struct watch *watch)
+{
+  watch->ready_next = NULL;
+  if (ready_last == NULL)
+    ready_first = watch;
+  else
+    ready_last->ready_next = watch;
+  ready_last = watch;
+}
+
+/*
+ * gives 'event' to the workers. Returns 0 if no worker is started.
+ */
+static int
+_worker_post_ (struct event *event)
+{
+  struct watch *watch;
+
+  LOCK (workers);
+  if (worker_count == 0)
+    {
+      UNLOCK (workers);
+      return 0;
+    }
+  watch = event->notif->watch;
+  event->next = NULL;
+  if (watch->pending_last == NULL)
+    watch->pending = event;
+  else
+    watch->pending_last->next = event;
+  watch->pending_last = event;
+  if (!watch->scheduled)
+    {
+      watch->scheduled = 1;
+      _worker_ready_ (watch);
+      pthread_cond_signal (&cond_workers);
+    }
+  UNLOCK (workers);
+  return 1;
+}
+
+/*
+ * the loop of the workers. It stops when asked and nothing is ready.
+ */
+static void *
+_worker_main_ (void *arg)
+{
+  struct watch *watch;
+  struct event *event;
+
+  LOCK (workers);
+  for (;;)
+    {
+      while (ready_first == NULL && !workers_stopping)
+	pthread_cond_wait (&cond_workers, &mutex_workers);
+      watch = ready_first;
+      if (watch == NULL)
+	break;
+      ready_first = watch->ready_next;
+      if (ready_first == NULL)
+	ready_last = NULL;
+      event = watch->pending;
+      watch->pending = event->next;
+      if (watch->pending == NULL)
+	watch->pending_last = NULL;
+      UNLOCK (workers);
+
+      if (!__atomic_load_n (&event->notif->removed, __ATOMIC_ACQUIRE))
+	event->notif->callback (&event->node, event->notif->userdata);
+
+      /*
+       * the event keeps the watch valid until freed 
+       */
+      LOCK (workers);
+      if (watch->pending != NULL)
+	_worker_ready_ (watch);
+      else
+	watch->scheduled = 0;
+      UNLOCK (workers);
+      _keynode_free_string_ (&event->node);
+      free (event);
+      _notify_read_end_ ();
+      LOCK (workers);
+    }
+
+  /*
+   * the last worker leaving switches to the inline delivery, once all
+   * the events given to the workers ran
+   */
+  if (--workers_alive == 0)
+    worker_count = 0;
+  UNLOCK (workers);
+  return arg;
+}
+
+/*
+ * stops the workers after they delivered the pending events. The events
+ * posted while they stop are still given to them so that the events of
+ * a key are never run inline before its earlier ones.
+ */
+static void
+_workers_stop_ ()
+{
+  pthread_t *threads;
+  unsigned index, count;
+
+  LOCK (workers);
+  threads = worker_threads;
+  count = worker_count;
+  workers_stopping = 1;
+  pthread_cond_broadcast (&cond_workers);
+  UNLOCK (workers);
+
+  for (index = 0; index < count; index++)
+    pthread_join (threads[index], NULL);
+
+  LOCK (workers);
+  assert (worker_count == 0);
+  worker_threads = NULL;
+  workers_stopping = 0;
+  UNLOCK (workers);
+  free (threads);
+}
+#endif
+
+/*
+ * sends 'event' to the main context, the worker or the callback of its
+ * notification
+ */
+static void
+_event_route_ (struct event *event)
+{
+#if !defined(NO_GLIB)
+  if (_loop_post_ (event))
+    return;
+#endif
+#if !defined(NO_MULTITHREADING)
+  if (_worker_post_ (event))
+    return;
+#endif
+#if !defined(NO_GLIB)
+  if (_main_post_ (event))
+    return;
+#endif
+  _event_run_ (event);
+}
+
+/*
+ * arms the timer for the time 'due' in milliseconds, disarms it if 0
+ */
+static void
+_timer_arm_ (unsigned long long due)
+{
+  struct itimerspec spec;
+
+  if (timer_fd < 0)
+    return;
+  memset (&spec, 0, sizeof spec);
+  spec.it_value.tv_sec = (time_t) (due / 1000);
+  spec.it_value.tv_nsec = (long) (due % 1000) * 1000000;
+  if (timerfd_settime (timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+    ERR ("Can't arm the delivery timer: %m");
+}
+
+/*
+ * records the expiration of the timer if any
+ */
+static void
+_timer_read_ ()
+{
+  unsigned long long expirations;
+
+  if (timer_fd >= 0
+      && read (timer_fd, &expirations, sizeof expirations) > 0)
+    __atomic_store_n (&timer_fired, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * delivers now or holds 'event' of a notification having a minimum
+ * interval or a debounce delay. A held change is replaced by the newer.
+ */
+static void
+_event_delay_ (struct event *event)
+{
+  struct notify *notif;
+  unsigned long long now, due;
+
+  notif = event->notif;
+  now = _now_ms_ ();
+  if (notif->debounce != 0)
+    {
+      due = now + notif->debounce;
+      if (due < notif->last + notif->min_interval)
+	due = notif->last + notif->min_interval;
+    }
+  else if (notif->held == NULL && now >= notif->last + notif->min_interval)
+    {
+      notif->last = now;
+      _event_route_ (event);
+      return;
+    }
+  else
+    due = notif->held != NULL ? notif->due : notif->last + notif->min_interval;
+
+  if (notif->held != NULL)
+    _event_drop_ (notif->held);
+  else
+    {
+      notif->held_next = held_notifies;
+      held_notifies = notif;
+    }
+  notif->held = event;
+  notif->due = due;
+}
+
+/*
+ * delivers the held changes that are due, drops the ones of removed
+ * notifications and arms the timer for the next one
+ */
+static void
+_held_release_ ()
+{
+  struct notify *notif, **prev;
+  struct event *event;
+  unsigned long long now, next;
+
+  now = _now_ms_ ();
+  next = 0;
+  prev = &held_notifies;
+  while ((notif = *prev) != NULL)
+    {
+      if (notif->due > now
+	  && !__atomic_load_n (&notif->removed, __ATOMIC_ACQUIRE))
+	{
+	  if (next == 0 || notif->due < next)
+	    next = notif->due;
+	  prev = &notif->held_next;
+	  continue;
+	}
+      /*
+       * 'notif' may be freed once its event is delivered
+       */
+      *prev = notif->held_next;
+      event = notif->held;
+      notif->held = NULL;
+      if (notif->removed)
+	_event_drop_ (event);
+      else
+	{
+	  notif->last = now;
+	  _event_route_ (event);
+	}
+    }
+  _timer_arm_ (next);
+}
+
+/*
+ * adds 'event' to the changes of its batch subscription
+ */
+static void
+_batch_collect_ (struct event *event)
+{
+  struct batch *batch;
+
+  batch = event->notif->batch;
+  if (batch->events == NULL)
+    {
+      batch->ready_next = ready_batches;
+      ready_batches = batch;
+    }
+  event->next = batch->events;
+  batch->events = event;
+}
+
+/*
+ * calls the batch subscriptions having changes with the keylist of the
+ * latest value of each changed key
+ */
+static void
+_batch_flush_ ()
+{
+  struct batch *batch;
+  struct event *event, *next, *events;
+  keylist_t *keylist;
+  keynode_t *keynode;
+
+  while ((batch = ready_batches) != NULL)
+    {
+      ready_batches = batch->ready_next;
+
+      /*
+       * in their order of arrival, the latest values replace the older
+       */
+      events = NULL;
+      for (event = batch->events; event != NULL; event = next)
+	{
+	  next = event->next;
+	  event->next = events;
+	  events = event;
+	}
+      batch->events = NULL;
+
+      keylist = __atomic_load_n (&batch->removed, __ATOMIC_ACQUIRE) ?
+	NULL : vconf_keylist_new ();
+      for (event = events; keylist != NULL && event != NULL;
+	   event = event->next)
+	if (!__atomic_load_n (&event->notif->removed, __ATOMIC_ACQUIRE))
+	  {
+	    keynode = _keylist_getadd_ (keylist, event->node.keyname,
+					event->node.type);
+	    if (keynode != NULL)
+	      {
+		_keynode_free_string_ (keynode);
+		keynode->value = event->node.value;
+		event->node.type = type_unset;
+	      }
+	  }
+      if (keylist != NULL)
+	{
+	  if (keylist->num != 0)
+	    batch->callback (keylist, batch->userdata);
+	  vconf_keylist_free (keylist);
+	}
+
+      /*
+       * the events keep the batch alive until its callback returned
+       */
+      for (event = events; event != NULL; event = next)
+	{
+	  next = event->next;
+	  _event_drop_ (event);
+	}
+    }
+}
+
+/*
+ * delivers the queued events in their order of arrival. One thread at a
+ * time delivers so that the changes of a key keep their order; the
+ * events queued meanwhile, even by the callbacks, are delivered by that
+ * thread. The notifications keeping only the latest value skip the
+ * older changes of the pass and the batch subscriptions get the changes
+ * of the pass together. No lock must be held.
+ */
+static void
+_deliver_events_ ()
+{
+  struct event *event, *next;
+
+  _notify_recover_ ();
+  while ((event_queue != NULL
+	  || __atomic_load_n (&timer_fired, __ATOMIC_ACQUIRE))
+	 && __sync_lock_test_and_set (&event_delivering, 1) == 0)
+    {
+      event = _event_take_ (&event_queue);
+      for (next = event; next != NULL; next = next->next)
+	if (next->notif != NULL && next->notif->latest_only)
+	  next->notif->latest = next;
+      for (; event != NULL; event = next)
+	{
+	  next = event->next;
+	  if (event->notif == NULL)
+	    _async_continue_ (event->async);
+#if !defined(NO_GLIB)
+	  else if (event->notif->batch != NULL && _main_post_ (event))
+	    continue;
+#endif
+	  else if (event->notif->batch != NULL)
+	    _batch_collect_ (event);
+	  else if (event->notif->latest_only && event->notif->latest != event)
+	    _event_drop_ (event);
+	  else if (event->notif->min_interval != 0
+		   || event->notif->debounce != 0)
+	    _event_delay_ (event);
+	  else
+	    _event_route_ (event);
+	}
+      if (ready_batches != NULL)
+	_batch_flush_ ();
+      __atomic_store_n (&timer_fired, 0, __ATOMIC_RELEASE);
+      if (held_notifies != NULL)
+	_held_release_ ();
+      __sync_lock_release (&event_delivering);
+    }
+}
+
+/*
+ * A watched key is registered once to buxton whatever the count of its
+ * notifications. A change is queued for each notification of the array
+ * current when it is received.
+ */
+static void
+_cb_notify_ (BuxtonResponse resp, struct watch *watch)
+{
+  struct event *event;
+  struct notify_set *set;
+  keynode_t node;
+  unsigned index;
+
+  switch (buxton_response_type (resp))
+    {
+    case BUXTON_CONTROL_NOTIFY:
+      watch->status =
+	buxton_response_status (resp) == 0 ? VCONF_OK : VCONF_ERROR;
+      break;
+    case BUXTON_CONTROL_CHANGED:
+      memset (&node, 0, sizeof node);
+      node.keyname = watch->node.keyname;
+      node.type = watch->node.type;
+      if (_set_response_to_keynode_ (resp, &node, 1) != VCONF_OK)
+	break;
+      watch->node.type = node.type;
+      _notify_read_begin_ ();
+      set = __atomic_load_n (&watch->set, __ATOMIC_ACQUIRE);
+      for (index = 0; set != NULL && index < set->count; index++)
+	{
+	  event = calloc (1, sizeof *event);
+	  if (event == NULL)
+	    {
+	      ERR ("Allocation of event failed");
+	      break;
+	    }
+	  event->node = node;
+	  if (node.type == type_string)
+	    {
+	      event->node.value.s = strdup (node.value.s);
+	      if (event->node.value.s == NULL)
+		{
+		  ERR ("Allocation of event failed");
+		  free (event);
+		  break;
+		}
+	    }
+	  event->notif = set->items[index];
+	  _notify_read_begin_ ();
+	  _event_push_ (&event_queue, event);
+	}
+      _notify_read_end_ ();
+      _keynode_free_string_ (&node);
+      break;
+    default:
+      break;
+    }
+}
+
+/*
+ * registers or unregisters 'watch' to buxton, the lock 'notify' must be
+ * held. Both use the key of unset type. The unregistration has no
+ * callback and waits its response: when it returns, buxton doesn't call
+ * anymore the callback of the watch that can be freed. If it fails, the
+ * connection is dropped for the same reason.
+ */
+static int
+_notify_reg_unreg_ (struct watch *watch, bool reg)
+{
+  int status;
+  struct keycache *key;
+
+  status = _open_buxton_ ();
+  retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
+
+  key = _get_buxton_key_of_ (watch->node.keyname, type_unset);
+  retvm_if (key == NULL, VCONF_ERROR, "Can't create buxton key");
+  LOCK(buxton);
+  watch->status = VCONF_OK;	/* on success calback isn't called! */
+  if (the_buxton_client == NULL)
+    status = -1;
+  else if (reg)
+    {
+      watch->generation = the_buxton_client_generation;
+      status = buxton_register_notification (_buxton_ (), key->key,
+					     (BuxtonCallback) _cb_notify_,
+					     watch, false);
+    }
+  else if (watch->generation != the_buxton_client_generation)
+    status = 0;			/* lost with its client */
+  else
+    {
+      status = buxton_unregister_notification (_buxton_ (), key->key,
+					       NULL, NULL, true);
+      if (status != 0)
+	_drop_buxton_ ();
+      else
+	_wake_buxton_reader_ ();
+    }
+  _release_buxton_key_ (key);
+  UNLOCK(buxton);
+  return status == 0 && watch->status == VCONF_OK ? VCONF_OK : VCONF_ERROR;
+}
+
+/*
+ * tells if 'watch' is registered to the current shared client,
+ * the lock 'notify' must be held
+ */
+static inline int
+_watch_is_registered_ (struct watch *watch)
+{
+  int result;
+
+  LOCK (buxton);
+  result = watch->registered
+    && watch->generation == the_buxton_client_generation;
+  UNLOCK (buxton);
+  return result;
+}
+
+/*
+ * registers again the watched keys after the loss of the shared client.
+ * No lock must be held.
+ */
+static void
+_notify_recover_ ()
+{
+  struct watch *watch;
+  unsigned index;
+  int status;
+
+  if (!__atomic_load_n (&watches_lost, __ATOMIC_ACQUIRE))
+    return;
+
+  LOCK (notify);
+  if (watch_count == 0)
+    watches_lost = 0;
+  status = watches_lost && _open_buxton_ ();
+  if (status)
+    {
+      /*
+       * the watches stay lost until all of them are registered again 
+       */
+      watches_lost = 0;
+      for (index = 0; index < watch_bucket_count; index++)
+	for (watch = watch_buckets[index]; watch != NULL;
+	     watch = watch->next)
+	  if (!_watch_is_registered_ (watch))
+	    {
+	      watch->registered =
+		_notify_reg_unreg_ (watch, true) == VCONF_OK;
+	      if (!watch->registered)
+		watches_lost = 1;
+	    }
+    }
+  UNLOCK (notify);
+#if !defined(NO_GLIB)
+  if (status)
+    _glib_start_watch_ ();
+#endif
+}
+
+/*
+ * tells if 'keyname' has a notification of 'callback' for 'prefix' and
+ * 'batch', the lock 'notify' must be held
+ */
+static int
+_notify_find_ (const char *keyname, vconf_callback_fn callback,
+	       struct prefix *prefix, struct batch *batch)
+{
+  struct notify_set *set;
+  struct watch *watch;
+  unsigned index;
+
+  watch = _watch_lookup_ (keyname, _hash_name_ (keyname));
+  set = watch != NULL ? watch->set : NULL;
+  for (index = 0; set != NULL && index < set->count; index++)
+    if (set->items[index]->prefix == prefix
+	&& set->items[index]->batch == batch
+	&& set->items[index]->callback == callback)
+      return 1;
+  return 0;
+}
+
+/*
+ * adds a notification of 'callback' for 'keyname' and registers the key
+ * to buxton with its first notification. A directory watch or a batch
+ * adds only one notification per key. the lock 'notify' must be held.
+ */
+static int
+_notify_add_ (const char *keyname, vconf_callback_fn callback,
+	      void *userdata, struct prefix *prefix, struct batch *batch,
+	      const vconf_notify_options_t *options)
+{
+  struct notify *notif;
+  struct watch *watch;
+
+  if ((prefix != NULL || batch != NULL)
+      && _notify_find_ (keyname, callback, prefix, batch))
+    return VCONF_OK;
+
+  /*
+   * create the notification 
+   */
+  notif = malloc (sizeof *notif);
+  retvm_if (notif == NULL, VCONF_ERROR,
+	    "Allocation of notify structure failed");
+  notif->callback = callback;
+  notif->userdata = userdata;
+  notif->prefix = prefix;
+  notif->batch = batch;
+  notif->removed = 0;
+  notif->min_interval = options != NULL ? options->min_interval : 0;
+  notif->debounce = options != NULL ? options->debounce : 0;
+  notif->latest_only = options != NULL && options->latest_only;
+  notif->latest = NULL;
+  notif->held = NULL;
+  notif->last = 0;
+#if !defined(NO_GLIB)
+  notif->loop = NULL;
+#endif
+
+  /*
+   * add it to the watch of keyname 
+   */
+  watch = _watch_get_ (keyname);
+  if (watch == NULL || _watch_add_ (watch, notif) != VCONF_OK)
+    {
+      if (watch != NULL && watch->set == NULL)
+	_watch_remove_ (watch, 0);
+      free (notif);
+      return VCONF_ERROR;
+    }
+  notif->watch = watch;
+#if !defined(NO_GLIB)
+  if (options != NULL && options->thread_context)
+    notif->loop = _loop_get_ (g_main_context_get_thread_default ());
+#endif
+
+  /*
+   * register the key to buxton for its first notification 
+   */
+  if (!_watch_is_registered_ (watch))
+    {
+      if (_notify_reg_unreg_ (watch, true) != VCONF_OK)
+	{
+	  _watch_del_ (watch, callback, prefix, batch);
+	  if (watch->set == NULL)
+	    _watch_remove_ (watch, 1);
+	  notif->next = retired_notifies;
+	  retired_notifies = notif;
+	  _notify_reclaim_ ();
+	  return VCONF_ERROR;
+	}
+      watch->registered = 1;
+    }
+  return VCONF_OK;
+}
+
+/*
+ * removes the notifications of 'callback' for 'prefix' and 'batch' from
+ * 'watch' and unregisters its key with its last notification. The removed
+ * notifications are retired. Returns 0 if none was found.
+ * the lock 'notify' must be held.
+ */
+static int
+_notify_del_ (struct watch *watch, vconf_callback_fn callback,
+	      struct prefix *prefix, struct batch *batch)
+{
+  struct notify *delent, *entry;
+
+  delent = _watch_del_ (watch, callback, prefix, batch);
+  if (delent == NULL)
+    return 0;
+
+  if (watch->set == NULL)
+    {
+      if (watch->registered)
+	_notify_reg_unreg_ (watch, false);
+      _watch_remove_ (watch, 1);
+    }
+
+  for (entry = delent; entry->next != NULL; entry = entry->next);
+  entry->next = retired_notifies;
+  retired_notifies = delent;
+  return 1;
+}
+
+/*
+ * The directory watches add a notification to each key of their
+ * directory found by scanning it. As buxton doesn't notify the creation
+ * of keys, the keys set by this process in a watched directory are
+ * added after being set; the keys created by others are added by
+ * watching the directory again, which scans it again.
+ */
+
+/*
+ * get the watch of 'directory' for 'callback' or NULL,
+ * the lock 'notify' must be held
+ */
+static struct prefix *
+_prefix_lookup_ (const char *directory, size_t length,
+		 vconf_callback_fn callback)
+{
+  struct prefix *prefix;
+
+  for (prefix = prefixes; prefix != NULL; prefix = prefix->next)
+    if (prefix->callback == callback && prefix->length == length + 1
+	&& !memcmp (prefix->directory, directory, length))
+      break;
+  return prefix;
+}
+
+/*
+ * adds to the directory watches the keys of 'keylist' set in their
+ * directory
+ */
+static void
+_prefix_catch_ (keylist_t * keylist)
+{
+  struct prefix *prefix;
+  keynode_t *keynode;
+
+  if (__atomic_load_n (&prefixes, __ATOMIC_RELAXED) == NULL)
+    return;
+
+  LOCK (notify);
+  for (keynode = keylist->head; keynode != NULL; keynode = keynode->next)
+    if (keynode->status == VCONF_OK && keynode->type >= type_string
+	&& keynode->type <= type_bool)
+      for (prefix = prefixes; prefix != NULL; prefix = prefix->next)
+	if (!strncmp (keynode->keyname, prefix->directory, prefix->length))
+	  _notify_add_ (keynode->keyname, prefix->callback,
+			prefix->userdata, prefix, NULL, NULL);
+  UNLOCK (notify);
+}
+
+/*================= SECTION cache =============*/
+
+/*
+ * The cache keeps the values of the keys read by vconf_get_* and keeps
+ * them up to date by registering a buxton notification for each cached
+ * key. The entries of the shared cache are created and removed with the
+ * locks 'buxton' and 'cache' held, in that order. The caches of the
+ * contexts are only accessed by the thread using the context and are
+ * notified through the connection of the context.
+ */
+
+static inline void
+_cache_lock_ (struct cache *cache)
+{
+  if (cache->ctx == NULL)
+    {
+      LOCK (cache);
+    }
+}
+
+static inline void
+_cache_unlock_ (struct cache *cache)
+{
+  if (cache->ctx == NULL)
+    {
+      UNLOCK (cache);
+    }
+}
+
+/*
+ * get the client receiving the notifications of 'cache' or NULL
+ */
+static inline BuxtonClient
+_cache_client_ (struct cache *cache)
+{
+  return cache->ctx != NULL ? cache->ctx->connection.client
+    : the_buxton_client;
+}
+
+static inline struct cache_entry *
+_cache_lookup_ (struct cache *cache, const char *keyname, unsigned hash)
+{
+  struct cache_entry *entry;
+
+  if (cache->buckets == NULL)
+    return NULL;
+
+  entry = cache->buckets[hash & (cache->bucket_count - 1)];
+  while (entry != NULL
+	 && (entry->hash != hash || strcmp (entry->node.keyname, keyname)))
+    entry = entry->next;
+  return entry;
+}
+
+static void
+_cb_cache_ (BuxtonResponse resp, struct cache_entry *entry)
+{
+  struct cache *cache = entry->cache;
+
+  _cache_lock_ (cache);
+  switch (buxton_response_type (resp))
+    {
+    case BUXTON_CONTROL_NOTIFY:
+      if (buxton_response_status (resp) != 0)
+	{
+	  entry->status = VCONF_ERROR;
+	  entry->valid = 0;
+	}
+      break;
+    case BUXTON_CONTROL_CHANGED:
+      entry->valid =
+	_set_response_to_keynode_ (resp, &entry->node, 0) == VCONF_OK;
+      break;
+    default:
+      break;
+    }
+  _cache_unlock_ (cache);
+}
+
+/*
+ * registers or unregisters the notification of 'entry'. The
+ * unregistration has no callback and waits its response: the changes
+ * received before are handled and, when it returns, buxton doesn't call
+ * anymore the callback of the entry that can be freed.
+ */
+static int
+_cache_reg_unreg_ (struct cache_entry *entry, bool reg)
+{
+  int status;
+  struct keycache *key;
+  struct cache *cache = entry->cache;
+
+  key = _get_buxton_key_in_ (cache->ctx, entry->node.keyname, type_unset);
+  retvm_if (key == NULL, VCONF_ERROR, "Can't create buxton key");
+  if (reg)
+    status = buxton_register_notification (_cache_client_ (cache), key->key,
+					   (BuxtonCallback) _cb_cache_,
+					   entry, false);
+  else
+    status = buxton_unregister_notification (_cache_client_ (cache),
+					     key->key, NULL, NULL, true);
+  _release_buxton_key_ (key);
+  return status == 0 ? VCONF_OK : VCONF_ERROR;
+}
+
+/*
+ * remove all the entries of 'cache'. For the shared cache, the lock
+ * 'buxton' must be held.
+ */
+static void
+_cache_flush_ (struct cache *cache)
+{
+  unsigned index;
+  struct cache_entry *entry, *removed;
+
+  _cache_lock_ (cache);
+  removed = NULL;
+  for (index = 0; index < cache->bucket_count; index++)
+    {
+      while ((entry = cache->buckets[index]) != NULL)
+	{
+	  cache->buckets[index] = entry->next;
+	  entry->next = removed;
+	  removed = entry;
+	}
+    }
+  free (cache->buckets);
+  cache->buckets = NULL;
+  cache->bucket_count = 0;
+  cache->count = 0;
+  cache->generation++;
+  _cache_unlock_ (cache);
+
+  /*
+   * the callbacks of the removed entries, taking the lock 'cache', may
+   * run until their unregistration returns. An entry whose notification
+   * can't be unregistered is freed with the connection that is dropped.
+   */
+  while ((entry = removed) != NULL)
+    {
+      removed = entry->next;
+      if (_cache_client_ (cache) != NULL
+	  && _cache_reg_unreg_ (entry, false) != VCONF_OK)
+	{
+	  if (cache->ctx != NULL)
+	    _ctx_drop_ (cache->ctx);
+	  else
+	    _drop_buxton_ ();
+	}
+      if (entry->node.type == type_string)
+	free (entry->node.value.s);
+      free (entry);
+    }
+  if (cache->ctx == NULL && the_buxton_client != NULL)
+    _wake_buxton_reader_ ();
+}
+
+/*
+ * process the notifications already received for 'cache' so that a hit
+ * doesn't serve a changed value. For the shared cache, unless the
+ * dispatcher thread processes them, the connection is polled without
+ * lock and the lock 'buxton' is only taken when it is readable, which
+ * also detects its loss.
+ */
+static void
+_cache_sync_ (struct cache *cache)
+{
+  struct timespec now;
+  struct pollfd pfd;
+  int status;
+
+  if (cache->ctx == NULL)
+    {
+#if !defined(NO_MULTITHREADING)
+      if (__atomic_load_n (&dispatcher_running, __ATOMIC_ACQUIRE))
+	return;
+#endif
+      pfd.fd = __atomic_load_n (&the_buxton_client_fd, __ATOMIC_ACQUIRE);
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (pfd.fd < 0 || poll (&pfd, 1, 0) != 1)
+	return;
+      LOCK (buxton);
+      status = _drain_buxton_ (0);
+      UNLOCK (buxton);
+      if (status != 0)
+	_deliver_events_ ();
+      return;
+    }
+
+  if (cache->ctx->connection.client == NULL)
+    return;
+
+  do
+    status = _dispatch_connection_ (&cache->ctx->connection,
+				    _deadline_ (&now, 0));
+  while (status == VCONF_OK);
+  if (status == VCONF_ERROR)
+    _ctx_drop_ (cache->ctx);
+}
+
+/*
+ * get the value of 'keynode' from 'entry' that can be NULL, the lock
+ * 'cache' must be held.
+ * returns 1 if found or 0 otherwise.
+ */
+static inline int
+_cache_entry_get_ (struct cache_entry *entry, keynode_t * keynode)
+{
+  if (entry == NULL || !entry->valid || entry->node.type != keynode->type)
+    return 0;
+  if (keynode->type != type_string)
+    {
+      keynode->value = entry->node.value;
+      return 1;
+    }
+  keynode->value.s = strdup (entry->node.value.s);
+  return keynode->value.s != NULL;
+}
+
+/*
+ * get the value of 'keynode' from 'cache'.
+ * returns 1 if found or 0 otherwise.
+ */
+static int
+_cache_get_ (struct cache *cache, keynode_t * keynode)
+{
+  struct cache_entry *entry;
+  int result;
+
+  if (cache->capacity == 0)
+    return 0;
+
+  _cache_sync_ (cache);
+
+  _cache_lock_ (cache);
+  entry = _cache_lookup_ (cache, keynode->keyname,
+			  _hash_name_ (keynode->keyname));
+  result = _cache_entry_get_ (entry, keynode);
+  _cache_unlock_ (cache);
+
+  if (result)
+    STAT_INC (cache_hits);
+  else
+    STAT_INC (cache_misses);
+  return result;
+}
+
+/*
+ * creates the entry of 'keyname' in 'cache' if possible and registers
+ * its notification. The client of the cache must be connected and, for
+ * the shared cache, the lock 'buxton' must be held.
+ * returns 1 if the entry exists or 0 otherwise.
+ */
+static int
+_cache_create_ (struct cache *cache, const char *keyname)
+{
+  struct cache_entry *entry;
+  unsigned hash;
+  size_t length;
+  char *name;
+
+  hash = _hash_name_ (keyname);
+  _cache_lock_ (cache);
+  entry = _cache_lookup_ (cache, keyname, hash);
+  if (entry != NULL || cache->count >= cache->capacity)
+    {
+      _cache_unlock_ (cache);
+      return entry != NULL;
+    }
+
+  if (cache->buckets == NULL)
+    {
+      cache->bucket_count = 1;
+      while (cache->bucket_count < cache->capacity)
+	cache->bucket_count <<= 1;
+      cache->buckets = calloc (cache->bucket_count, sizeof *cache->buckets);
+      if (cache->buckets == NULL)
+	{
+	  ERR ("Can't allocate memory for the cache");
+	  cache->bucket_count = 0;
+	  _cache_unlock_ (cache);
+	  return 0;
+	}
+    }
+
+  length = strlen (keyname);
+  entry = calloc (1, 1 + length + sizeof *entry);
+  if (entry == NULL)
+    {
+      ERR ("Can't allocate memory for the cache");
+      _cache_unlock_ (cache);
+      return 0;
+    }
+  name = (char *) (entry + 1);
+  memcpy (name, keyname, length + 1);
+  entry->node.keyname = name;
+  entry->node.type = type_unset;
+  entry->cache = cache;
+  entry->hash = hash;
+  entry->status = VCONF_OK;
+  entry->next = cache->buckets[hash & (cache->bucket_count - 1)];
+  cache->buckets[hash & (cache->bucket_count - 1)] = entry;
+  cache->count++;
+  _cache_unlock_ (cache);
+
+  if (_cache_reg_unreg_ (entry, true) != VCONF_OK)
+    entry->status = VCONF_ERROR;
+  return 1;
+}
+
+/*
+ * creates if possible the entry of 'keyname' and registers its
+ * notification. This must be done before reading the value so that
+ * no change can be missed. The value must then be read on the client
+ * of the notification, after the registration: the changes made before
+ * the read are in its response and the changes made after it are
+ * notified. Returns 1 when the value read from the shared client may be
+ * recorded in the entry, 0 otherwise.
+ */
+static int
+_cache_prepare_ (struct cache *cache, const char *keyname)
+{
+  int result;
+
+  if (cache->capacity == 0)
+    return 0;
+
+  if (cache->ctx != NULL)
+    {
+      if (_ctx_open_ (cache->ctx))
+	_cache_create_ (cache, keyname);
+      return 0;
+    }
+
+  if (!_open_buxton_ ())
+    return 0;
+
+  result = 0;
+  LOCK (buxton);
+  if (the_buxton_client != NULL)
+    result = _cache_create_ (cache, keyname);
+  UNLOCK (buxton);
+#if !defined(NO_GLIB)
+  if (result)
+    _glib_start_watch_ ();
+#endif
+  return result;
+}
+
+/*
+ * records in 'cache' the value of 'keynode'. If 'force' is not set,
+ * the value is recorded only if the cached value isn't valid.
+ */
+static void
+_cache_put_ (struct cache *cache, keynode_t * keynode, int force)
+{
+  struct cache_entry *entry;
+  char *copy;
+
+  if (cache->count == 0)
+    return;
+
+  _cache_lock_ (cache);
+  entry = _cache_lookup_ (cache, keynode->keyname,
+			  _hash_name_ (keynode->keyname));
+  if (entry != NULL && entry->status == VCONF_OK && (force || !entry->valid))
+    {
+      switch (keynode->type)
+	{
+	case type_string:
+	  copy = strdup (keynode->value.s);
+	  if (entry->node.type == type_string)
+	    free (entry->node.value.s);
+	  entry->node.value.s = copy;
+	  entry->node.type = type_string;
+	  entry->valid = copy != NULL;
+	  break;
+	case type_int:
+	case type_double:
+	case type_bool:
+	  if (entry->node.type == type_string)
+	    free (entry->node.value.s);
+	  entry->node.value = keynode->value;
+	  entry->node.type = keynode->type;
+	  entry->valid = 1;
+	  break;
+	default:
+	  entry->valid = 0;
+	  break;
+	}
+    }
+  _cache_unlock_ (cache);
+}
+
+/*
+ * invalidates the value of 'keyname' cached in 'cache'
+ */
+static void
+_cache_invalidate_ (struct cache *cache, const char *keyname)
+{
+  struct cache_entry *entry;
+
+  if (cache->count == 0)
+    return;
+
+  _cache_lock_ (cache);
+  entry = _cache_lookup_ (cache, keyname, _hash_name_ (keyname));
+  if (entry != NULL)
+    entry->valid = 0;
+  _cache_unlock_ (cache);
+}
+
+/*
+ * updates 'cache' after a call to vconf_set using the status of the keys
+ */
+static void
+_cache_put_list_ (struct cache *cache, keylist_t * keylist)
+{
+  keynode_t *keynode;
+
+  if (cache->count == 0)
+    return;
+
+  for (keynode = keylist->head; keynode != NULL; keynode = keynode->next)
+    switch (keynode->type)
+      {
+      case type_unset:
+      case type_directory:
+	break;
+      case type_delete:
+	_cache_invalidate_ (cache, keynode->keyname);
+	break;
+      default:
+	if (keynode->status == VCONF_OK)
+	  _cache_put_ (cache, keynode, 1);
+	else
+	  _cache_invalidate_ (cache, keynode->keyname);
+	break;
+      }
+}
+
+#if !defined(NO_GLIB)
+/*
+ * callback of glib for the delivery timer
+ */
+static gboolean
+_cb_glib_timer_ (GIOChannel * src, GIOCondition cond, gpointer data)
+{
+  _timer_read_ ();
+  _deliver_events_ ();
+  return G_SOURCE_CONTINUE;
+}
+
+/*================= SECTION glib =============*/
+
+static gboolean
+_cb_glib_ (GIOChannel * src, GIOCondition cond, gpointer data)
+{
+  int status;
+
+  /*
+   * the watched connection may have been dropped 
+   */
+  LOCK (buxton);
+  status = the_buxton_client != NULL
+    && glib_source_fd == the_buxton_client_fd ? _drain_buxton_ (1) : -1;
+  UNLOCK (buxton);
+  _deliver_events_ ();
+  if (status < 0) {
+    glib_source = NULL;
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static int
+_glib_start_watch_ ()
+{
+  GIOChannel *gio;
+
+  if (timer_fd >= 0 && glib_timer_source == NULL)
+    {
+      gio = g_io_channel_unix_new (timer_fd);
+      retvm_if (gio == NULL, VCONF_ERROR, "Error: create a new GIOChannel");
+      glib_timer_source = g_io_create_watch (gio, G_IO_IN);
+      g_io_channel_unref (gio);
+      retvm_if (glib_timer_source == NULL, VCONF_ERROR,
+		"Error: create a new GSource");
+      g_source_set_callback (glib_timer_source,
+			     (GSourceFunc) _cb_glib_timer_, NULL, NULL);
+      g_source_attach (glib_timer_source, glib_context);
+      g_source_unref (glib_timer_source);
+    }
+
+  if (glib_source != NULL)
+    {
+      if (glib_source_fd == the_buxton_client_fd)
+	return VCONF_OK;
+      g_source_destroy (glib_source);
+      glib_source = NULL;
+    }
+
+  gio = g_io_channel_unix_new (the_buxton_client_fd);
+  retvm_if (gio == NULL, VCONF_ERROR, "Error: create a new GIOChannel");
+
+  g_io_channel_set_flags (gio, G_IO_FLAG_NONBLOCK, NULL);
+
+  glib_source = g_io_create_watch (gio, G_IO_IN);
+  if (glib_source == NULL)
+    {
+      ERR ("Error: create a new GSource");
+      g_io_channel_unref (gio);
+      return VCONF_ERROR;
+    }
+
+  glib_source_fd = the_buxton_client_fd;
+  g_source_set_callback (glib_source, (GSourceFunc) _cb_glib_, NULL, NULL);
+  g_source_attach (glib_source, glib_context);
+  g_io_channel_unref (gio);
+  g_source_unref (glib_source);
+
+  return VCONF_OK;
+}
+
+static void
+_glib_stop_watch_ ()
+{
+  if (glib_source != NULL)
+    {
+      g_source_destroy (glib_source);
+      glib_source = NULL;
+    }
+  if (glib_timer_source != NULL)
+    {
+      g_source_destroy (glib_timer_source);
+      glib_timer_source = NULL;
+    }
+}
+
+/*
+ * stops watching the connection when nothing waits for it,
+ * the lock 'notify' must be held
+ */
+static void
+_glib_stop_unused_ ()
+{
+  LOCK (buxton);
+  if (watch_count == 0 && async_pending == NULL && the_cache.count == 0)
+    _glib_stop_watch_ ();
+  UNLOCK (buxton);
+}
+
+/*
+ * The callbacks of the notifications registered with the option
+ * thread_context by a thread having a thread-default main context other
+ * than glib_context are run by that context. Each such context has one
+ * source, shared by its notifications, that runs its queued events. The
+ * list of sources is protected by the lock 'notify'.
+ * When glib_context is set, the other callbacks are run by its source
+ * glib_loop, so that the threads delivering the changes never run them.
+ */
+
+static gboolean
+_loop_prepare_ (GSource * source, gint * timeout)
+{
+  *timeout = -1;
+  return __atomic_load_n (&((struct loop *) source)->queue,
+			  __ATOMIC_ACQUIRE) != NULL;
+}
+
+static gboolean
+_loop_check_ (GSource * source)
+{
+  return __atomic_load_n (&((struct loop *) source)->queue,
+			  __ATOMIC_ACQUIRE) != NULL;
+}
+
+/*
+ * runs the events of a source in their order. The changes of the batch
+ * subscriptions, posted to glib_loop, are delivered again by the thread
+ * running it.
+ */
+static void
+_loop_run_ (struct event *event)
+{
+  struct event *next;
+  int deliver;
+
+  deliver = 0;
+  for (; event != NULL; event = next)
+    {
+      next = event->next;
+      if (event->notif->batch != NULL)
+	{
+	  _event_push_ (&event_queue, event);
+	  deliver = 1;
+	}
+      else
+	_event_run_ (event);
+    }
+  if (deliver)
+    _deliver_events_ ();
+}
+
+static gboolean
+_loop_dispatch_ (GSource * source, GSourceFunc callback, gpointer data)
+{
+  _loop_run_ (_event_take_ (&((struct loop *) source)->queue));
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+_loop_finalize_ (GSource * source)
+{
+  g_main_context_unref (((struct loop *) source)->context);
+}
+
+static GSourceFuncs loop_funcs = {
+  .prepare = _loop_prepare_,
+  .check = _loop_check_,
+  .dispatch = _loop_dispatch_,
+  .finalize = _loop_finalize_
+};
+
+/*
+ * creates a source running events in 'context'
+ */
+static struct loop *
+_loop_new_ (GMainContext * context)
+{
+  struct loop *loop;
+
+  loop = (struct loop *) g_source_new (&loop_funcs, sizeof *loop);
+  retvm_if (loop == NULL, NULL, "Allocation of main context source failed");
+  loop->context = g_main_context_ref (context);
+  loop->refcount = 1;
+  loop->queue = NULL;
+  loop->next = NULL;
+  g_source_attach (&loop->source, context);
+  return loop;
+}
+
+/*
+ * get the source of 'context' or NULL if the callbacks are run without,
+ * the lock 'notify' must be held
+ */
+static struct loop *
+_loop_get_ (GMainContext * context)
+{
+  struct loop *loop;
+
+  if (context == NULL || context == glib_context)
+    return NULL;
+
+  for (loop = loops; loop != NULL; loop = loop->next)
+    if (loop->context == context)
+      {
+	loop->refcount++;
+	return loop;
+      }
+
+  loop = _loop_new_ (context);
+  if (loop != NULL)
+    {
+      loop->next = loops;
+      loops = loop;
+    }
+  return loop;
+}
+
+/*
+ * release the source 'loop' of a freed notification,
+ * the lock 'notify' must be held
+ */
+static void
+_loop_release_ (struct loop *loop)
+{
+  struct loop **prev;
+
+  if (loop == NULL || --loop->refcount != 0)
+    return;
+
+  for (prev = &loops; *prev != loop; prev = &(*prev)->next);
+  *prev = loop->next;
+  g_source_destroy (&loop->source);
+  g_source_unref (&loop->source);
+}
+
+/*
+ * gives 'event' to the source of its notification.
+ * Returns 0 if the notification has no source.
+ */
+static int
+_loop_post_ (struct event *event)
+{
+  struct loop *loop;
+
+  loop = event->notif->loop;
+  if (loop == NULL)
+    return 0;
+  _event_push_ (&loop->queue, event);
+  g_main_context_wakeup (loop->context);
+  return 1;
+}
+
+/*
+ * gives 'event' to the source of glib_context when it is set. The thread
+ * running glib_context runs the event itself unless older events are
+ * queued. Returns 0 if the event must be run by the calling thread.
+ */
+static int
+_main_post_ (struct event *event)
+{
+  struct loop *loop;
+  int posted;
+
+  posted = 0;
+  __sync_add_and_fetch (&glib_loop_posting, 1);
+  loop = __atomic_load_n (&glib_loop, __ATOMIC_ACQUIRE);
+  if (loop != NULL
+      && (!g_main_context_is_owner (loop->context)
+	  || __atomic_load_n (&loop->queue, __ATOMIC_ACQUIRE) != NULL))
+    {
+      _event_push_ (&loop->queue, event);
+      g_main_context_wakeup (loop->context);
+      posted = 1;
+    }
+  __sync_sub_and_fetch (&glib_loop_posting, 1);
+  return posted;
+}
+#endif
+
+/*================= SECTION VCONF API =============*/
+
+const char *
+vconf_keynode_get_name (keynode_t * keynode)
+{
+  retvm_if (keynode == NULL, NULL, "Invalid argument: keynode is NULL");
+  retvm_if (keynode->keyname == NULL, NULL, "The name of keynode is NULL");
+
+  return keynode->keyname;
+}
+
+int
+vconf_keynode_get_type (keynode_t * keynode)
+{
+  retvm_if (keynode == NULL,
+	    VCONF_ERROR, "Invalid argument: keynode is NULL");
+
+  switch (keynode->type)
+    {
+    case type_directory:
+      return VCONF_TYPE_DIR;
+    case type_string:
+      return VCONF_TYPE_STRING;
+    case type_int:
+      return VCONF_TYPE_INT;
+    case type_double:
+      return VCONF_TYPE_DOUBLE;
+    case type_bool:
+      return VCONF_TYPE_BOOL;
+    default:
+      return VCONF_TYPE_NONE;
+    }
+}
+
+int
+vconf_keynode_get_int (keynode_t * keynode)
+{
+  retvm_if (keynode == NULL,
+	    VCONF_ERROR, "Invalid argument: keynode is NULL");
+  retvm_if (keynode->type != type_int, VCONF_ERROR,
+	    "The type of keynode(%s) is not INT", keynode->keyname);
+
+  return keynode->value.i;
+}
+
+double
+vconf_keynode_get_dbl (keynode_t * keynode)
+{
+  retvm_if (keynode == NULL, -1.0, "Invalid argument: keynode is NULL");
+  retvm_if (keynode->type != type_double, -1.0,
+	    "The type of keynode(%s) is not DBL", keynode->keyname);
+
+  return keynode->value.d;
+}
+
+int
+vconf_keynode_get_bool (keynode_t * keynode)
+{
+  retvm_if (keynode == NULL,
+	    VCONF_ERROR, "Invalid argument: keynode is NULL");
+  retvm_if (keynode->type != type_bool, VCONF_ERROR,
+	    "The type of keynode(%s) is not BOOL", keynode->keyname);
+
+  return !!(keynode->value.b);
+}
+
+char *
+vconf_keynode_get_str (keynode_t * keynode)
+{
+  retvm_if (keynode == NULL, NULL, "Invalid argument: keynode is NULL");
+  retvm_if (keynode->type != type_string, NULL,
+	    "The type of keynode(%s) is not STR", keynode->keyname);
+
+  return keynode->value.s;
+}
+
+int
+vconf_set_default_group (const char *groupname)
+{
+  char *copy;
+
+  char *previous;
+
+  copy = _dup_groupname_ (groupname);
+  if (copy == NULL)
+    return VCONF_ERROR;
+
+  /*
+   * the cached values and buxton keys are bound to the previous group.
+   * The values are flushed first so that their notifications are
+   * unregistered with the keys of the previous group. The flush also
+   * unlinks the prepared keys from the flushed entries.
+   */
+  LOCK (buxton);
+  _cache_flush_ (&the_cache);
+  LOCK (keys);
+  LOCK (group);
+  previous = default_group;
+  default_group = copy;
+  UNLOCK (group);
+  _keycache_flush_ ();
+  UNLOCK (keys);
+  UNLOCK (buxton);
+  free (previous);
+  _deliver_events_ ();
+  return VCONF_OK;
+}
+
+keylist_t *
+vconf_keylist_new ()
+{
+  keylist_t *result;
+  if (_ensure_default_group_ () != VCONF_OK)
+    return NULL;
+  result = calloc (1, sizeof (keylist_t));
+  LOCK (counter);
+  internal_list_count += (result != NULL);
+  UNLOCK (counter);
+  return result;
+}
+
+keylist_t *
+vconf_keylist_new_arena ()
+{
+  keylist_t *result;
+  struct arena_chunk *arena;
+
+  if (_ensure_default_group_ () != VCONF_OK)
+    return NULL;
+
+  /*
+   * the list itself lives in the first chunk of its arena 
+   */
+  arena = NULL;
+  result = _arena_alloc_ (&arena, sizeof (keylist_t));
+  retvm_if (result == NULL, NULL, "allocation of keylist failed");
+  memset (result, 0, sizeof (keylist_t));
+  result->arena = arena;
+
+  LOCK (counter);
+  internal_list_count++;
+  UNLOCK (counter);
+  return result;
+}
+
+int
+vconf_keylist_free (keylist_t * keylist)
+{
+  keynode_t *keynode, *temp;
+
+  retvm_if (keylist == NULL,
+	    VCONF_ERROR, "Invalid argument: keylist is NULL");
+
+  keynode = keylist->head;
+  free (keylist->index);
+  if (keylist->arena != NULL)
+    _arena_free_ (keylist->arena);
+  else
+    {
+      while (keynode)
+	{
+	  temp = keynode->next;
+	  _keynode_free_ (keynode);
+	  keynode = temp;
+	}
+      free (keylist);
+    }
+
+  LOCK (counter);
+  internal_list_count -= (internal_list_count > 0);
+  UNLOCK (counter);
+  _check_close_buxton_ ();
+  return 0;
+}
+
+int
+vconf_keylist_rewind (keylist_t * keylist)
+{
+  retvm_if (keylist == NULL,
+	    VCONF_ERROR, "Invalid argument: keylist is NULL");
+
+  keylist->cursor = NULL;
+
+  return 0;
+}
+
+keynode_t *
+vconf_keylist_nextnode (keylist_t * keylist)
+{
+  keynode_t *result;
+
+  retvm_if (keylist == NULL, NULL, "Invalid argument: keylist is NULL");
+
+  result = keylist->cursor;
+  result = result == NULL ? keylist->head : result->next;
+  keylist->cursor = result;
+
+  return result;
+}
+
+int
+vconf_keylist_lookup (keylist_t * keylist,
+		      const char *keyname, keynode_t ** return_node)
+{
+  keynode_t *keynode;
+
+  retvm_if (keylist == NULL,
+	    VCONF_ERROR, "Invalid argument: keylist is NULL");
+  retvm_if (keyname == NULL,
+	    VCONF_ERROR, "Invalid argument: keyname is NULL");
+  retvm_if (return_node == NULL,
+	    VCONF_ERROR, "Invalid argument: return_node is NULL");
+
+  keynode = _keylist_lookup_ (keylist, keyname, NULL);
+  if (NULL == keynode)
+    return 0;
+
+  if (return_node)
+    *return_node = keynode;
+  return keynode->type;
+}
+
+static int
+_cb_sort_keynodes (const void *a, const void *b)
+{
+  register const keynode_t *kna = *(const keynode_t **) a;
+  register const keynode_t *knb = *(const keynode_t **) b;
+  return strcmp (kna->keyname, knb->keyname);
+}
+
+int
+vconf_keylist_sort (keylist_t * keylist)
+{
+  int index;
+  keynode_t **nodes, *keynode;
+
+  retvm_if (keylist == NULL,
+	    VCONF_ERROR, "Invalid argument: keylist is NULL");
+
+  if (keylist->num <= 1)
+    return VCONF_OK;
+
+  nodes = malloc (keylist->num * sizeof *nodes);
+  retvm_if (nodes == NULL, VCONF_ERROR, "can't allocate memory for sorting");
+
+  index = 0;
+  keynode = keylist->head;
+  while (keynode != NULL)
+    {
+      assert (index < keylist->num);
+      nodes[index++] = keynode;
+      keynode = keynode->next;
+    }
+  assert (index == keylist->num);
+
+  qsort (nodes, index, sizeof *nodes, _cb_sort_keynodes);
+
+  while (index)
+    {
+      nodes[--index]->next = keynode;
+      if (keynode)
+	keynode->prev = &nodes[index]->next;
+      keynode = nodes[index];
+    }
+  keylist->head = keynode;
+  keynode->prev = &keylist->head;
+  free (nodes);
+  return VCONF_OK;
+}
+
+int
+vconf_keylist_add_int (keylist_t * keylist, const char *keyname,
+		       const int value)
+{
+  keynode_t *keynode;
+
+  retvm_if (keylist == NULL,
+	    VCONF_ERROR, "Invalid argument: keylist is NULL");
+  retvm_if (keyname == NULL,
+	    VCONF_ERROR, "Invalid argument: keyname is NULL");
+
+  keynode = _keylist_getadd_ (keylist, keyname, type_int);
+  if (keynode == NULL)
+    return VCONF_ERROR;
+
+  keynode->value.i = value;
+  return keylist->num;
+}
+
+int
+vconf_keylist_add_bool (keylist_t * keylist, const char *keyname,
+			const int value)
+{
+  keynode_t *keynode;
+
+  retvm_if (keylist == NULL,
+	    VCONF_ERROR, "Invalid argument: keylist is NULL");
+  retvm_if (keyname == NULL,
+	    VCONF_ERROR, "Invalid argument: keyname is NULL");
+
+  keynode = _keylist_getadd_ (keylist, keyname, type_bool);
+  if (keynode == NULL)
+    return VCONF_ERROR;
+
+  keynode->value.b = !!value;
+  return keylist->num;
+}
+
+int
+vconf_keylist_add_dbl (keylist_t * keylist,
+		       const char *keyname, const double value)
+{
+  keynode_t *keynode;
+
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+  retvm_if (keyname == NULL, VCONF_ERROR,
+	    "Invalid argument: keyname is NULL");
+
+  keynode = _keylist_getadd_ (keylist, keyname, type_double);
+  if (keynode == NULL)
+    return VCONF_ERROR;
+
+  keynode->value.d = value;
+  return keylist->num;
+}
+
+int
+vconf_keylist_add_str (keylist_t * keylist,
+		       const char *keyname, const char *value)
+{
+  keynode_t *keynode;
+  char *copy;
+  size_t length;
+
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+  retvm_if (keyname == NULL, VCONF_ERROR,
+	    "Invalid argument: keyname is NULL");
+
+  if (value == NULL)
+    value = "";
+  if (keylist->arena != NULL)
+    {
+      length = 1 + strlen (value);
+      copy = _arena_alloc_ (&keylist->arena, length);
+      retvm_if (copy == NULL, VCONF_ERROR, "Allocation of memory failed");
+      memcpy (copy, value, length);
+    }
+  else
+    {
+      copy = strdup (value);
+      retvm_if (copy == NULL, VCONF_ERROR, "Allocation of memory failed");
+    }
+
+  keynode = _keylist_getadd_ (keylist, keyname, type_string);
+  if (keynode == NULL)
+    {
+      if (keylist->arena == NULL)
+	free (copy);
+      return VCONF_ERROR;
+    }
+
+  _keynode_free_string_ (keynode);
+  keynode->value.s = copy;
+  return keylist->num;
+}
+
+int
+vconf_keylist_add_null (keylist_t * keylist, const char *keyname)
+{
+  keynode_t *keynode;
+
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+  retvm_if (keyname == NULL, VCONF_ERROR,
+	    "Invalid argument: keyname is NULL");
+
+  keynode = _keylist_getadd_ (keylist, keyname, type_unset);
+  if (keynode == NULL)
+    return VCONF_ERROR;
+
+  return keylist->num;
+}
+
+int
+vconf_keylist_del (keylist_t * keylist, const char *keyname)
+{
+  keynode_t *keynode;
+
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+  retvm_if (keyname == NULL, VCONF_ERROR,
+	    "Invalid argument: keyname is NULL");
+
+  keynode = _keylist_lookup_ (keylist, keyname, NULL);
+  if (keynode == NULL)
+    return VCONF_ERROR;
+
+  _keylist_unlink_ (keylist, keynode);
+  _keynode_free_ (keynode);
+
+  return VCONF_OK;
+}
+
+static int
+_set_ (vconf_ctx_t * ctx, keylist_t * keylist,
+       const struct timespec *deadline)
+{
+  int status;
+
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+
+  status = _apply_buxton_on_list_ (ctx, keylist, _async_set_or_unset_, NULL,
+				   0, deadline);
+  _cache_put_list_ (_cache_of_ (ctx), keylist);
+  _prefix_catch_ (keylist);
+  return status;
+}
+
+int
+vconf_set (keylist_t * keylist)
+{
+  return vconf_set_timed (keylist, _default_timeout_ ());
+}
+
+int
+vconf_set_timed (keylist_t * keylist, int timeout)
+{
+  struct timespec deadline;
+
+  return _set_ (NULL, keylist, _deadline_ (&deadline, timeout));
+}
+
+int
+vconf_set_async (keylist_t * keylist, vconf_done_fn cb, void *user_data)
+{
+  return _apply_async_ (keylist, _async_set_or_unset_, 1, cb, user_data);
+}
+
+int
+vconf_set_many (vconf_desc_t * descs, unsigned count)
+{
+  return vconf_set_many_timed (descs, count, _default_timeout_ ());
+}
+
+int
+vconf_set_many_timed (vconf_desc_t * descs, unsigned count, int timeout)
+{
+  keylist_t list;
+  keynode_t *nodes, *node;
+  unsigned index;
+  int status, pass;
+  struct timespec deadline;
+
+  retvm_if (descs == NULL && count != 0, VCONF_ERROR,
+	    "Invalid argument: descs is NULL");
+  if (count == 0)
+    return VCONF_OK;
+
+  status = _ensure_default_group_ ();
+  if (status != VCONF_OK)
+    return status;
+
+  nodes = calloc (count, sizeof *nodes);
+  retvm_if (nodes == NULL, VCONF_ERROR, "Allocation of memory failed");
+
+  /*
+   * the nodes refer to the values of the descriptors 
+   */
+  memset (&list, 0, sizeof list);
+  for (index = count; index-- > 0;)
+    {
+      node = &nodes[index];
+      node->keyname = descs[index].keyname;
+      node->type = _keytype_of_vconf_type_ (descs[index].type);
+      node->list = &list;
+      node->status = VCONF_ERROR;
+      if (node->keyname == NULL || node->type == type_unset
+	  || descs[index].value == NULL || !_check_keyname_ (node->keyname))
+	{
+	  ERR ("Invalid descriptor %u", index);
+	  continue;
+	}
+      switch (node->type)
+	{
+	case type_string:
+	  node->value.s = *(char **) descs[index].value;
+	  if (node->value.s == NULL)
+	    node->value.s = (char *) "";
+	  break;
+	case type_int:
+	  node->value.i = *(int *) descs[index].value;
+	  break;
+	case type_double:
+	  node->value.d = *(double *) descs[index].value;
+	  break;
+	default:
+	  node->value.b = *(int *) descs[index].value != 0;
+	  break;
+	}
+      node->next = list.head;
+      list.head = node;
+      list.num++;
+    }
+
+  pass = VCONF_OK;
+  if (list.num != 0)
+    {
+      pass = _apply_buxton_on_list_ (NULL, &list, _async_set_or_unset_, NULL,
+				     0, _deadline_ (&deadline, timeout));
+      _cache_put_list_ (&the_cache, &list);
+      _prefix_catch_ (&list);
+    }
+
+  status = VCONF_OK;
+  for (index = 0; index < count; index++)
+    {
+      descs[index].status = nodes[index].status;
+      if (nodes[index].status != VCONF_OK)
+	status = VCONF_ERROR;
+    }
+
+  free (nodes);
+  return pass == VCONF_ERROR_TIMEOUT ? pass : status;
+}
+
+int
+vconf_set_labels (keylist_t * keylist, const char *label)
+{
+  struct timespec deadline;
+
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+
+  retvm_if (label == NULL, VCONF_ERROR, "Invalid argument: name is NULL");
+
+  return _apply_buxton_on_list_ (NULL, keylist, _async_set_label_, label,
+				 0, _deadline_ (&deadline,
+						_default_timeout_ ()));
+}
+
+int
+vconf_sync_key (const char *keyname)
+{
+  /*
+   * does nothing succefully 
+   */
+  return 0;
+}
+
+/*
+ * reads the keys of 'keylist', on the shared client if 'shared' is set
+ */
+static inline int
+_refresh_ (vconf_ctx_t * ctx, keylist_t * keylist, int shared,
+	   const struct timespec *deadline)
+{
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+
+  return _apply_buxton_on_list_ (ctx, keylist, _async_refresh_, NULL,
+				 shared, deadline);
+}
+
+int
+vconf_refresh (keylist_t * keylist)
+{
+  return vconf_refresh_timed (keylist, _default_timeout_ ());
+}
+
+int
+vconf_refresh_timed (keylist_t * keylist, int timeout)
+{
+  struct timespec deadline;
+
+  return _refresh_ (NULL, keylist, 0, _deadline_ (&deadline, timeout));
+}
+
+int
+vconf_refresh_async (keylist_t * keylist, vconf_done_fn cb, void *user_data)
+{
+  return _apply_async_ (keylist, _async_refresh_, 0, cb, user_data);
+}
+
+int
+vconf_scan (keylist_t * keylist, const char *dirpath, get_option_t option)
+{
+  return vconf_scan_timed (keylist, dirpath, option, _default_timeout_ ());
+}
+
+/*
+ * adds to 'keylist' the names found in 'dirpath' without their values
+ */
+static int
+_scan_names_ (keylist_t * keylist, const char *dirpath, get_option_t option,
+	      const struct timespec *deadline)
+{
+  char *dircopy, *group;
+  struct layer_key laykey;
+  struct scanning_data data;
+  int status;
+  unsigned generation;
+
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is null");
+  retvm_if (keylist->num != 0, VCONF_ERROR,
+	    "Invalid argument: keylist not empty");
+  retvm_if (dirpath == NULL, VCONF_ERROR,
+	    "Invalid argument: dirpath is null");
+  retvm_if (_check_keyname_ (dirpath) == 0, VCONF_ERROR,
+	    "Invalid argument: dirpath is not valid");
+
+  status = _open_buxton_ ();
+  if (!status)
+    {
+      ERR ("Can't connect to buxton");
+      return VCONF_ERROR;
+    }
+
+  data.keylist = keylist;
+
+  switch (option)
+    {
+    case VCONF_GET_KEY:
+      data.want_directories = 0;
+      data.want_keys = 1;
+      data.is_recursive = 0;
+      break;
+    case VCONF_GET_ALL:
+      data.want_directories = 1;
+      data.want_keys = 1;
+      data.is_recursive = 0;
+      break;
+    case VCONF_GET_DIR:
+      data.want_directories = 1;
+      data.want_keys = 0;
+      data.is_recursive = 0;
+      break;
+    case VCONF_GET_KEY_REC:
+      data.want_directories = 0;
+      data.want_keys = 1;
+      data.is_recursive = 1;
+      break;
+    case VCONF_GET_ALL_REC:
+      data.want_directories = 1;
+      data.want_keys = 1;
+      data.is_recursive = 1;
+      break;
+    case VCONF_GET_DIR_REC:
+      data.want_directories = 0;
+      data.want_keys = 1;
+      data.is_recursive = 1;
+      break;
+    default:
+      ERR ("Invalid argument: Bad option value");
+      return VCONF_ERROR;
+    }
+
+  data.dirlen = strlen (dirpath);
+  assert (data.dirlen);
+  if (dirpath[data.dirlen - 1] == '/')
+    {
+      data.directory = dirpath;
+      dircopy = NULL;
+    }
+  else
+    {
+      status = asprintf (&dircopy, "%s/", dirpath);
+      retvm_if (status < 0, VCONF_ERROR,
+		"No more memory for copying dirpath");
+      data.directory = dircopy;
+      data.dirlen++;
+    }
+
+  status = _get_layer_key_ (data.directory, &laykey);
+  if (status != VCONF_OK)
+    {
+      free (dircopy);
+      return status;
+    }
+
+  /*
+   * the default group may be replaced and freed by an other thread 
+   */
+  group = NULL;
+  if (_ensure_default_group_ () == VCONF_OK)
+    {
+      LOCK (group);
+      group = strdup (default_group);
+      UNLOCK (group);
+    }
+  if (group == NULL)
+    {
+      free (dircopy);
+      ERR ("No more memory for copying the group");
+      return VCONF_ERROR;
+    }
+
+  data.prefix = laykey.prefix;
+  if (!laykey.key[0])
+    {
+      laykey.key = NULL;
+    }
+
+  data.sent = 1;
+  data.received = 0;
+  LOCK (buxton);
+  if (the_buxton_client == NULL)
+    status = VCONF_ERROR;
+  else
+    {
+      generation = the_buxton_client_generation;
+      the_buxton_client_users++;
+      status = buxton_list_names (_buxton_ (), laykey.layer, group,
+				  laykey.key, (BuxtonCallback) _cb_scan_,
+				  &data, false);
+      if (status)
+	data.sent = data.received;
+      while (!status && data.received != data.sent)
+	status = _wait_shared_buxton_ (&data.sent, &data.received,
+				       generation, deadline);
+      if (data.received != data.sent
+	  && generation == the_buxton_client_generation
+	  && _orphan_add_ (&data))
+	_drop_buxton_ ();
+      the_buxton_client_users--;
+    }
+  UNLOCK (buxton);
+  _deliver_events_ ();
+
+  free (group);
+  free (dircopy);
+
+  if (status == VCONF_ERROR_TIMEOUT)
+    return status;
+  retvm_if (status, VCONF_ERROR, "Error while calling buxton_list_names: %m");
+  if (data.cb_status != VCONF_OK)
     {
-      return 1;
+      return VCONF_ERROR;
     }
 
-  ERR ("Error while calling buxton_set_value: %m");
-  return -1;
+  return VCONF_OK;
 }
 
-static inline int
-_async_unset_ (keynode_t * keynode)
+int
+vconf_scan_timed (keylist_t * keylist, const char *dirpath,
+		  get_option_t option, int timeout)
 {
+  struct timespec ts;
+  const struct timespec *deadline;
   int status;
-  BuxtonKey key;
 
-  assert (keynode != NULL);
+  deadline = _deadline_ (&ts, timeout);
+  status = _scan_names_ (keylist, dirpath, option, deadline);
+  if (status != VCONF_OK)
+    return status;
 
-  if (keynode->type != type_delete)
-    {
-      return 0;
-    }
+  return _refresh_ (NULL, keylist, 0, deadline);
+}
 
-  key = _get_buxton_key_ (keynode);
-  if (key == NULL)
-    {
-      return -1;
-    }
+int
+vconf_get (keylist_t * keylist, const char *dirpath, get_option_t option)
+{
+  return vconf_get_timed (keylist, dirpath, option, _default_timeout_ ());
+}
 
-  status = buxton_unset_value (_buxton_ (), key,
-			       (BuxtonCallback) _cb_inc_received_,
-			       keynode, false);
-  buxton_key_free (key);
+int
+vconf_get_timed (keylist_t * keylist, const char *dirpath,
+		 get_option_t option, int timeout)
+{
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
 
-  if (status == 0)
+  if (option == VCONF_REFRESH_ONLY
+      || (option == VCONF_GET_KEY && keylist->num != 0))
     {
-      return 1;
+      return vconf_refresh_timed (keylist, timeout);
+    }
+  else
+    {
+      return vconf_scan_timed (keylist, dirpath, option, timeout);
     }
-
-  ERR ("Error while calling buxton_unset_value: %m");
-  return -1;
 }
 
-static inline int
-_async_set_or_unset_ (keynode_t * keynode, const char *unused)
+int
+vconf_get_async (keylist_t * keylist, const char *dirpath,
+		 get_option_t option, vconf_done_fn cb, void *user_data)
 {
-  assert (keynode != NULL);
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+  retvm_if (option != VCONF_REFRESH_ONLY
+	    && (option != VCONF_GET_KEY || keylist->num == 0), VCONF_ERROR,
+	    "Invalid argument: scanning isn't asynchronous");
 
-  switch (keynode->type)
-    {
-    case type_unset:
-    case type_directory:
-      return 0;
-    case type_delete:
-      return _async_unset_ (keynode);
-    default:
-      return _async_set_ (keynode);
-    }
+  return vconf_refresh_async (keylist, cb, user_data);
 }
 
-static inline int
-_async_refresh_ (keynode_t * keynode, const char *unused)
+int
+vconf_unset (const char *keyname)
 {
+  struct singleton single;
   int status;
-  BuxtonKey key;
 
-  assert (keynode != NULL);
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  switch (keynode->type)
+  status = _keylist_init_singleton_ (&single, keyname, type_delete);
+  if (status == VCONF_OK)
     {
-    case type_unset:
-    case type_string:
-    case type_int:
-    case type_double:
-    case type_bool:
-      break;
-    default:
-      return 0;
+      status = vconf_set (&single.list);
     }
+  return status;
 
-  key = _get_buxton_key_ (keynode);
-  if (key == NULL)
-    {
-      return -1;
-    }
+}
 
-  status = buxton_get_value (_buxton_ (), key,
-			     (BuxtonCallback) _cb_refresh_, keynode, false);
-  buxton_key_free (key);
+int
+vconf_exists (const char *keyname)
+{
+  struct singleton single;
+  int status;
 
-  if (status == 0)
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
+
+  status = _keylist_init_singleton_ (&single, keyname, type_unset);
+  if (status == VCONF_OK)
     {
-      return 1;
+      status = vconf_refresh (&single.list);
+      if (status == VCONF_OK && single.node.type == type_string)
+	free (single.node.value.s);
     }
+  return status;
 
-  ERR ("Error while calling buxton_get_value: %m");
-  return -1;
 }
 
-static inline int
-_async_set_label_ (keynode_t * keynode, const char *label)
+int
+vconf_unset_recursive (const char *in_dir)
 {
+  struct _keylist_t *keylist;
+  struct _keynode_t *keynode;
   int status;
-  BuxtonKey key;
 
-  assert (keynode != NULL);
+  retvm_if (in_dir == NULL, VCONF_ERROR, "Invalid argument: dir is null");
 
-  key = _get_buxton_key_ (keynode);
-  if (key == NULL)
+  keylist = vconf_keylist_new ();
+  if (keylist == NULL)
+    return VCONF_ERROR;
+
+  status = vconf_scan (keylist, in_dir, VCONF_GET_KEY_REC);
+  if (status == VCONF_OK)
     {
-      return -1;
+      for (keynode = keylist->head; keynode; keynode = keynode->next)
+	keynode->type = type_delete;
+      status = vconf_set (keylist);
     }
+  vconf_keylist_free (keylist);
+  return status;
+}
 
-  status = buxton_set_label (_buxton_ (), key, label,
-			     (BuxtonCallback) _cb_inc_received_,
-			     keynode, false);
-  buxton_key_free (key);
+int
+vconf_notify_key_changed (const char *keyname, vconf_callback_fn cb,
+			  void *user_data)
+{
+  int status;
 
-  if (status == 0)
-    {
-      return 1;
-    }
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is null");
+  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
+  status = _open_buxton_ ();
+  retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
+  status = vconf_exists (keyname);
+  retvm_if (status != VCONF_OK, VCONF_ERROR, "key %s doesn't exist", keyname);
 
-  ERR ("Error while calling buxton_set_label: %m");
-  return -1;
-}
+  LOCK (notify);
+  status = _notify_add_ (keyname, cb, user_data, NULL, NULL, NULL);
+  UNLOCK (notify);
+  if (status != VCONF_OK)
+    return status;
 
+#if !defined(NO_GLIB)
+  return _glib_start_watch_ ();
+#else
+  return VCONF_OK;
+#endif
+}
 
-static int
-_apply_buxton_on_list_ (keylist_t * keylist,
-			int (*async) (keynode_t *, const char *),
-			const char *data)
+int
+vconf_notify_key_changed_full (const char *keyname, vconf_callback_fn cb,
+			       void *user_data,
+			       const vconf_notify_options_t *options)
 {
-  keynode_t *keynode;
   int status;
-  int sent;
 
-  assert (keylist != NULL);
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is null");
+  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
+#if defined(NO_GLIB)
+  retvm_if (options != NULL && options->thread_context, VCONF_ERROR,
+	    "Main contexts need glib");
+#endif
+  status = _open_buxton_ ();
+  retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
+  status = vconf_exists (keyname);
+  retvm_if (status != VCONF_OK, VCONF_ERROR, "key %s doesn't exist", keyname);
+
+  LOCK (notify);
+  status = options == NULL
+    || (options->min_interval == 0 && options->debounce == 0) ?
+    VCONF_OK : _timer_open_ ();
+  if (status == VCONF_OK)
+    status = _notify_add_ (keyname, cb, user_data, NULL, NULL, options);
+  UNLOCK (notify);
+  if (status != VCONF_OK)
+    return status;
+
+#if !defined(NO_GLIB)
+  return _glib_start_watch_ ();
+#else
+  return VCONF_OK;
+#endif
+}
 
+int
+vconf_ignore_key_changed (const char *keyname, vconf_callback_fn cb)
+{
+  struct watch *watch;
+  int status;
+
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is null");
+  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
   status = _open_buxton_ ();
   retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
-  assert (_buxton_ () != NULL);
 
-  retvm_if (keylist->cb_active != 0, VCONF_ERROR,
-	    "Already active in vconf-buxton");
+  LOCK (notify);
+  watch = _watch_lookup_ (keyname, _hash_name_ (keyname));
+  if (watch == NULL || !_notify_del_ (watch, cb, NULL, NULL))
+    {
+      UNLOCK (notify);
+      ERR ("Not found: can't remove notification for key(%s)", keyname);
+      return VCONF_ERROR;
+    }
+#if !defined(NO_GLIB)
+  _glib_stop_unused_ ();
+#endif
 
-  LOCK(buxton);
+  /*
+   * the removed notifications are freed when no reader uses them 
+   */
+  _notify_reclaim_ ();
+  UNLOCK (notify);
 
-  keylist->cb_active = 1;
-  keylist->cb_status = VCONF_OK;
-  keylist->cb_sent = 0;
-  keylist->cb_received = 0;
+  return VCONF_OK;
+}
 
-  keynode = keylist->head;
-  status = _dispatch_buxton_ (1, 0);
-  while (keynode != NULL && status == VCONF_OK)
+int
+vconf_notify_dir_changed (const char *dirpath, vconf_callback_fn cb,
+			  void *user_data)
+{
+  keylist_t *keylist;
+  keynode_t *keynode;
+  struct prefix *prefix, **prev;
+  struct watch *watch;
+  struct timespec deadline;
+  size_t length;
+  int status, created;
+
+  retvm_if (dirpath == NULL, VCONF_ERROR, "Invalid argument: dir is null");
+  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
+  retvm_if (!_check_keyname_ (dirpath), VCONF_ERROR,
+	    "Invalid argument: dir is not valid");
+
+  length = strlen (dirpath);
+  if (dirpath[length - 1] == '/')
+    length--;
+
+  /*
+   * one request gets the names of the existing keys 
+   */
+  keylist = vconf_keylist_new ();
+  retvm_if (keylist == NULL, VCONF_ERROR, "Allocation of keylist failed");
+  status = _scan_names_ (keylist, dirpath, VCONF_GET_KEY_REC,
+			 _deadline_ (&deadline, _default_timeout_ ()));
+  if (status != VCONF_OK)
     {
-      sent = async (keynode, data);
-      keynode = keynode->next;
-      if (sent < 0)
-	{
-	  status = VCONF_ERROR;
-	}
-      else if (sent > 0)
+      vconf_keylist_free (keylist);
+      return status;
+    }
+
+  LOCK (notify);
+  prefix = _prefix_lookup_ (dirpath, length, cb);
+  if (prefix != NULL && prefix->userdata != user_data)
+    {
+      UNLOCK (notify);
+      vconf_keylist_free (keylist);
+      ERR ("The callback is already added with other data");
+      return VCONF_ERROR;
+    }
+  created = prefix == NULL;
+  if (created)
+    {
+      prefix = malloc (sizeof *prefix + length + 2);
+      if (prefix == NULL)
 	{
-	  keylist->cb_sent += sent;
-	  status = _dispatch_buxton_ (1, 0);
+	  UNLOCK (notify);
+	  vconf_keylist_free (keylist);
+	  ERR ("Allocation of directory watch failed");
+	  return VCONF_ERROR;
 	}
+      prefix->callback = cb;
+      prefix->userdata = user_data;
+      prefix->length = length + 1;
+      memcpy (prefix->directory, dirpath, length);
+      prefix->directory[length] = '/';
+      prefix->directory[length + 1] = 0;
+      prefix->next = prefixes;
+      prefixes = prefix;
     }
 
   /*
-   * get the responses 
+   * the keys getting a notification are marked so that a failure removes
+   * all the notifications added by this call 
    */
-  while (status == VCONF_OK && keylist->cb_sent != keylist->cb_received)
+  for (keynode = keylist->head; keynode != NULL; keynode = keynode->next)
+    keynode->status = 0;
+  for (keynode = keylist->head; keynode != NULL && status == VCONF_OK;
+       keynode = keynode->next)
     {
-      status = _dispatch_buxton_ (0, 0);
+      keynode->status = !_notify_find_ (keynode->keyname, cb, prefix, NULL);
+      status = _notify_add_ (keynode->keyname, cb, prefix->userdata, prefix,
+			     NULL, NULL);
     }
+  if (status != VCONF_OK)
+    {
+      for (keynode = keylist->head; keynode != NULL; keynode = keynode->next)
+	if (keynode->status)
+	  {
+	    watch = _watch_lookup_ (keynode->keyname,
+				    _hash_name_ (keynode->keyname));
+	    if (watch != NULL)
+	      _notify_del_ (watch, cb, prefix, NULL);
+	  }
+      if (created)
+	{
+	  for (prev = &prefixes; *prev != prefix; prev = &(*prev)->next);
+	  *prev = prefix->next;
+	  free (prefix);
+	}
+#if !defined(NO_GLIB)
+      _glib_stop_unused_ ();
+#endif
+      _notify_reclaim_ ();
+    }
+  UNLOCK (notify);
+  vconf_keylist_free (keylist);
+  if (status != VCONF_OK)
+    return status;
 
-  if (status == VCONF_OK && keylist->cb_status != VCONF_OK)
-    status = keylist->cb_status;
-  keylist->cb_active = 0;
-
-  UNLOCK(buxton);
+#if !defined(NO_GLIB)
+  return _glib_start_watch_ ();
+#else
+  return VCONF_OK;
+#endif
+}
 
-  _check_close_buxton_ ();
+int
+vconf_ignore_dir_changed (const char *dirpath, vconf_callback_fn cb)
+{
+  struct prefix *prefix, **prev;
+  struct watch *watch, *next;
+  unsigned index;
+  size_t length;
 
-  return status;
-}
+  retvm_if (dirpath == NULL, VCONF_ERROR, "Invalid argument: dir is null");
+  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
 
-/*================= SECTION notification =============*/
+  length = strlen (dirpath);
+  if (length != 0 && dirpath[length - 1] == '/')
+    length--;
 
-static void
-_cb_notify_ (BuxtonResponse resp, struct notify *notif)
-{
-  switch (buxton_response_type (resp))
+  LOCK (notify);
+  prefix = _prefix_lookup_ (dirpath, length, cb);
+  if (prefix == NULL)
     {
-    case BUXTON_CONTROL_NOTIFY:
-    case BUXTON_CONTROL_UNNOTIFY:
-      notif->status =
-	buxton_response_status (resp) == 0 ? VCONF_OK : VCONF_ERROR;
-      break;
-    case BUXTON_CONTROL_CHANGED:
-      if (_set_response_to_keynode_ (resp, notif->keynode, 1) == VCONF_OK)
-	{
-	  UNLOCK (buxton);
-	  notif->callback (notif->keynode, notif->userdata);
-	  LOCK (buxton);
-	}
-      break;
-    default:
-      break;
+      UNLOCK (notify);
+      ERR ("Not found: can't remove notification for dir(%s)", dirpath);
+      return VCONF_ERROR;
     }
+  for (prev = &prefixes; *prev != prefix; prev = &(*prev)->next);
+  *prev = prefix->next;
+
+  for (index = 0; index < watch_bucket_count; index++)
+    for (watch = watch_buckets[index]; watch != NULL; watch = next)
+      {
+	next = watch->next;
+	_notify_del_ (watch, cb, prefix, NULL);
+      }
+#if !defined(NO_GLIB)
+  _glib_stop_unused_ ();
+#endif
+  _notify_reclaim_ ();
+  UNLOCK (notify);
+
+  free (prefix);
+  return VCONF_OK;
 }
 
-static int
-_notify_reg_unreg_ (struct notify *notif, bool reg)
+int
+vconf_notify_batch_changed (keylist_t * keylist, vconf_batch_fn cb,
+			    void *user_data)
 {
+  keynode_t *keynode;
+  struct batch *batch;
   int status;
-  BuxtonKey key;
 
+  retvm_if (keylist == NULL, VCONF_ERROR,
+	    "Invalid argument: keylist is NULL");
+  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
   status = _open_buxton_ ();
   retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
+  for (keynode = keylist->head; keynode != NULL; keynode = keynode->next)
+    {
+      status = vconf_exists (keynode->keyname);
+      retvm_if (status != VCONF_OK, VCONF_ERROR, "key %s doesn't exist",
+		keynode->keyname);
+    }
 
-  LOCK(buxton);
-  key = _get_buxton_key_ (notif->keynode);
-  retvm_if (key == NULL, VCONF_ERROR, "Can't create buxton key");
-  notif->status = VCONF_OK;	/* on success calback isn't called! */
-  status =
-    (reg ? buxton_register_notification :
-     buxton_unregister_notification) (_buxton_ (), key,
-				      (BuxtonCallback) _cb_notify_,
-				      notif, false);
-  buxton_key_free (key);
-  UNLOCK(buxton);
-  return status == 0 && notif->status == VCONF_OK ? VCONF_OK : VCONF_ERROR;
-}
+  LOCK (notify);
+  for (batch = batches; batch != NULL && batch->callback != cb;
+       batch = batch->next);
+  if (batch != NULL && batch->userdata != user_data)
+    {
+      UNLOCK (notify);
+      ERR ("The callback is already added with other data");
+      return VCONF_ERROR;
+    }
+  if (batch == NULL)
+    {
+      batch = calloc (1, sizeof *batch);
+      if (batch == NULL)
+	{
+	  UNLOCK (notify);
+	  ERR ("Allocation of batch subscription failed");
+	  return VCONF_ERROR;
+	}
+      batch->callback = cb;
+      batch->userdata = user_data;
+      batch->next = batches;
+      batches = batch;
+    }
+  for (keynode = keylist->head; keynode != NULL && status == VCONF_OK;
+       keynode = keynode->next)
+    status = _notify_add_ (keynode->keyname, NULL, batch->userdata, NULL,
+			   batch, NULL);
+  UNLOCK (notify);
+  if (status != VCONF_OK)
+    return status;
 
 #if !defined(NO_GLIB)
-/*================= SECTION glib =============*/
-
-static gboolean
-_cb_glib_ (GIOChannel * src, GIOCondition cond, gpointer data)
-{
-  int status;
-
-  status = _handle_buxton_response_ (1);
-  if (status < 0) {
-    glib_source = NULL;
-    return G_SOURCE_REMOVE;
-  }
-  return G_SOURCE_CONTINUE;
+  return _glib_start_watch_ ();
+#else
+  return VCONF_OK;
+#endif
 }
 
-static int
-_glib_start_watch_ ()
+int
+vconf_ignore_batch_changed (vconf_batch_fn cb)
 {
-  GIOChannel *gio;
-
-  if (glib_source != NULL)
-    return VCONF_OK;
-
-  gio = g_io_channel_unix_new (the_buxton_client_fd);
-  retvm_if (gio == NULL, VCONF_ERROR, "Error: create a new GIOChannel");
+  struct batch *batch, **prev;
+  struct watch *watch, *next;
+  unsigned index;
 
-  g_io_channel_set_flags (gio, G_IO_FLAG_NONBLOCK, NULL);
+  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
 
-  glib_source = g_io_create_watch (gio, G_IO_IN);
-  if (glib_source == NULL)
+  LOCK (notify);
+  for (prev = &batches; *prev != NULL && (*prev)->callback != cb;
+       prev = &(*prev)->next);
+  batch = *prev;
+  if (batch == NULL)
     {
-      ERR ("Error: create a new GSource");
-      g_io_channel_unref (gio);
+      UNLOCK (notify);
+      ERR ("Not found: can't remove batch notification");
       return VCONF_ERROR;
     }
+  *prev = batch->next;
+  __atomic_store_n (&batch->removed, 1, __ATOMIC_RELEASE);
 
-  g_source_set_callback (glib_source, (GSourceFunc) _cb_glib_, NULL, NULL);
-  g_source_attach (glib_source, NULL);
-  g_io_channel_unref (gio);
-  g_source_unref (glib_source);
+  for (index = 0; index < watch_bucket_count; index++)
+    for (watch = watch_buckets[index]; watch != NULL; watch = next)
+      {
+	next = watch->next;
+	_notify_del_ (watch, NULL, NULL, batch);
+      }
+#if !defined(NO_GLIB)
+  _glib_stop_unused_ ();
+#endif
+
+  /*
+   * the batch is freed when no reader uses it
+   */
+  batch->next = retired_batches;
+  retired_batches = batch;
+  _notify_reclaim_ ();
+  UNLOCK (notify);
 
   return VCONF_OK;
 }
 
-static void
-_glib_stop_watch_ ()
+int
+vconf_get_fd (void)
 {
-  if (glib_source != NULL)
+  int status;
+
+  status = _open_buxton_ ();
+  retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
+
+  LOCK (buxton);
+  if (dispatch_fd < 0)
     {
-      g_source_destroy (glib_source);
-      glib_source = NULL;
+      dispatch_fd = epoll_create1 (EPOLL_CLOEXEC);
+      if (dispatch_fd < 0)
+	ERR ("Can't create the epoll handle: %m");
+      else
+	_dispatch_add_timer_ ();
     }
+  _dispatch_update_ ();
+  status = dispatch_fd;
+  UNLOCK (buxton);
+  return status < 0 ? VCONF_ERROR : status;
 }
-#endif
-
-/*================= SECTION VCONF API =============*/
 
-const char *
-vconf_keynode_get_name (keynode_t * keynode)
+int
+vconf_get_events (void)
 {
-  retvm_if (keynode == NULL, NULL, "Invalid argument: keynode is NULL");
-  retvm_if (keynode->keyname == NULL, NULL, "The name of keynode is NULL");
+  int events;
 
-  return keynode->keyname;
+  LOCK (buxton);
+  events = the_buxton_client != NULL ? POLLIN : 0;
+  UNLOCK (buxton);
+  return events;
 }
 
 int
-vconf_keynode_get_type (keynode_t * keynode)
+vconf_dispatch_pending (void)
 {
-  retvm_if (keynode == NULL,
-	    VCONF_ERROR, "Invalid argument: keynode is NULL");
+  int count;
+  unsigned long long expirations;
 
-  switch (keynode->type)
+  LOCK (buxton);
+  count = _drain_buxton_ (0);
+  if (dispatch_retry_fd >= 0
+      && read (dispatch_retry_fd, &expirations, sizeof expirations) < 0
+      && errno != EAGAIN)
+    ERR ("Can't read the retry timer: %m");
+  UNLOCK (buxton);
+  _timer_read_ ();
+  _deliver_events_ ();
+  return count < 0 ? VCONF_ERROR : count;
+}
+
+#if !defined(NO_MULTITHREADING)
+/*
+ * the loop of the dispatcher thread, until its stop event
+ */
+static void *
+_dispatcher_main_ (void *arg)
+{
+  struct epoll_event events[2];
+  int count, index, stop;
+
+  for (stop = 0; !stop;)
     {
-    case type_directory:
-      return VCONF_TYPE_DIR;
-    case type_string:
-      return VCONF_TYPE_STRING;
-    case type_int:
-      return VCONF_TYPE_INT;
-    case type_double:
-      return VCONF_TYPE_DOUBLE;
-    case type_bool:
-      return VCONF_TYPE_BOOL;
-    default:
-      return VCONF_TYPE_NONE;
+      count = epoll_wait (dispatcher_epoll, events, 2, -1);
+      if (count < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  ERR ("Error in the dispatcher: %m");
+	  break;
+	}
+      for (index = 0; index < count; index++)
+	if (events[index].data.fd == dispatcher_stop)
+	  stop = 1;
+      if (!stop)
+	vconf_dispatch_pending ();
     }
+  return arg;
 }
+#endif
 
 int
-vconf_keynode_get_int (keynode_t * keynode)
+vconf_start_dispatcher (void)
 {
-  retvm_if (keynode == NULL,
-	    VCONF_ERROR, "Invalid argument: keynode is NULL");
-  retvm_if (keynode->type != type_int, VCONF_ERROR,
-	    "The type of keynode(%s) is not INT", keynode->keyname);
+#if !defined(NO_MULTITHREADING)
+  struct epoll_event event;
+  int fd, status;
 
-  return keynode->value.i;
+  fd = vconf_get_fd ();
+  retvm_if (fd < 0, VCONF_ERROR, "Can't get the handle to dispatch");
+
+  LOCK (dispatcher);
+  if (dispatcher_running)
+    {
+      UNLOCK (dispatcher);
+      return VCONF_OK;
+    }
+  status = VCONF_ERROR;
+  dispatcher_epoll = epoll_create1 (EPOLL_CLOEXEC);
+  dispatcher_stop = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (dispatcher_epoll < 0 || dispatcher_stop < 0)
+    ERR ("Can't create the handles of the dispatcher: %m");
+  else
+    {
+      event.events = EPOLLIN;
+      event.data.fd = dispatcher_stop;
+      if (epoll_ctl (dispatcher_epoll, EPOLL_CTL_ADD, dispatcher_stop,
+		     &event) < 0)
+	ERR ("Can't watch the stop event: %m");
+      else
+	{
+	  event.data.fd = fd;
+	  if (epoll_ctl (dispatcher_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+	    ERR ("Can't watch the connection: %m");
+	  else if (pthread_create (&dispatcher_thread, NULL,
+				   _dispatcher_main_, NULL))
+	    ERR ("Creation of the dispatcher failed");
+	  else
+	    status = VCONF_OK;
+	}
+    }
+  if (status == VCONF_OK)
+    dispatcher_running = 1;
+  else
+    {
+      if (dispatcher_epoll >= 0)
+	close (dispatcher_epoll);
+      if (dispatcher_stop >= 0)
+	close (dispatcher_stop);
+      dispatcher_epoll = dispatcher_stop = -1;
+    }
+  UNLOCK (dispatcher);
+  return status;
+#else
+  ERR ("The dispatcher needs multithreading");
+  return VCONF_ERROR;
+#endif
 }
 
-double
-vconf_keynode_get_dbl (keynode_t * keynode)
+int
+vconf_stop_dispatcher (void)
 {
-  retvm_if (keynode == NULL, -1.0, "Invalid argument: keynode is NULL");
-  retvm_if (keynode->type != type_double, -1.0,
-	    "The type of keynode(%s) is not DBL", keynode->keyname);
+#if !defined(NO_MULTITHREADING)
+  uint64_t one = 1;
+  pthread_t thread;
+  int epoll, stop;
 
-  return keynode->value.d;
+  LOCK (dispatcher);
+  if (!dispatcher_running)
+    {
+      UNLOCK (dispatcher);
+      return VCONF_OK;
+    }
+  if (pthread_equal (dispatcher_thread, pthread_self ()))
+    {
+      UNLOCK (dispatcher);
+      ERR ("Can't stop the dispatcher from a callback");
+      return VCONF_ERROR;
+    }
+  thread = dispatcher_thread;
+  epoll = dispatcher_epoll;
+  stop = dispatcher_stop;
+  dispatcher_epoll = dispatcher_stop = -1;
+  dispatcher_running = 0;
+  UNLOCK (dispatcher);
+
+  if (write (stop, &one, sizeof one) < 0)
+    ERR ("Can't stop the dispatcher: %m");
+  pthread_join (thread, NULL);
+  close (epoll);
+  close (stop);
+  return VCONF_OK;
+#else
+  return VCONF_OK;
+#endif
 }
 
 int
-vconf_keynode_get_bool (keynode_t * keynode)
+vconf_set_int (const char *keyname, const int intval)
 {
-  retvm_if (keynode == NULL,
-	    VCONF_ERROR, "Invalid argument: keynode is NULL");
-  retvm_if (keynode->type != type_bool, VCONF_ERROR,
-	    "The type of keynode(%s) is not BOOL", keynode->keyname);
+  struct singleton single;
+  int status;
 
-  return !!(keynode->value.b);
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
+
+  status = _keylist_init_singleton_ (&single, keyname, type_int);
+  if (status == VCONF_OK)
+    {
+      single.node.value.i = intval;
+      status = vconf_set (&single.list);
+    }
+  return status;
 }
 
-char *
-vconf_keynode_get_str (keynode_t * keynode)
+int
+vconf_set_bool (const char *keyname, const int boolval)
 {
-  retvm_if (keynode == NULL, NULL, "Invalid argument: keynode is NULL");
-  retvm_if (keynode->type != type_string, NULL,
-	    "The type of keynode(%s) is not STR", keynode->keyname);
+  struct singleton single;
+  int status;
 
-  return keynode->value.s;
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
+
+  status = _keylist_init_singleton_ (&single, keyname, type_bool);
+  if (status == VCONF_OK)
+    {
+      single.node.value.b = (bool) boolval;
+      status = vconf_set (&single.list);
+    }
+  return status;
 }
 
 int
-vconf_set_default_group (const char *groupname)
+vconf_set_dbl (const char *keyname, const double dblval)
 {
-  char *copy;
+  struct singleton single;
+  int status;
 
-  copy = _dup_groupname_ (groupname);
-  if (copy == NULL)
-    return VCONF_ERROR;
-  free (default_group);
-  default_group = copy;
-  return VCONF_OK;
-}
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-keylist_t *
-vconf_keylist_new ()
-{
-  keylist_t *result;
-  if (_ensure_default_group_ () != VCONF_OK)
-    return NULL;
-  result = calloc (1, sizeof (keylist_t));
-  LOCK (counter);
-  internal_list_count += (result != NULL);
-  UNLOCK (counter);
-  return result;
+  status = _keylist_init_singleton_ (&single, keyname, type_double);
+  if (status == VCONF_OK)
+    {
+      single.node.value.d = dblval;
+      status = vconf_set (&single.list);
+    }
+  return status;
 }
 
 int
-vconf_keylist_free (keylist_t * keylist)
+vconf_set_str (const char *keyname, const char *strval)
 {
-  keynode_t *keynode, *temp;
+  struct singleton single;
+  int status;
 
-  retvm_if (keylist == NULL,
-	    VCONF_ERROR, "Invalid argument: keylist is NULL");
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  keynode = keylist->head;
-  free (keylist);
-  while (keynode)
+  status = _keylist_init_singleton_ (&single, keyname, type_string);
+  if (status == VCONF_OK)
     {
-      temp = keynode->next;
-      _keynode_free_ (keynode);
-      keynode = temp;
+      single.node.value.s = (char *) strval;
+      status = vconf_set (&single.list);
     }
-
-  LOCK (counter);
-  internal_list_count -= (internal_list_count > 0);
-  UNLOCK (counter);
-  _check_close_buxton_ ();
-  return 0;
+  return status;
 }
 
-int
-vconf_keylist_rewind (keylist_t * keylist)
+static int
+_get_singleton_ (vconf_ctx_t * ctx, struct singleton *single)
 {
-  retvm_if (keylist == NULL,
-	    VCONF_ERROR, "Invalid argument: keylist is NULL");
+  int status, shared;
+  struct cache *cache;
+  struct timespec deadline;
 
-  keylist->cursor = NULL;
+  cache = _cache_of_ (ctx);
+  if (_cache_get_ (cache, &single->node))
+    return VCONF_OK;
 
-  return 0;
+  shared = _cache_prepare_ (cache, single->node.keyname);
+  status = _refresh_ (ctx, &single->list, shared,
+		      _deadline_ (&deadline, _default_timeout_ ()));
+  if (status == VCONF_OK)
+    _cache_put_ (cache, &single->node, 0);
+  return status;
 }
 
-keynode_t *
-vconf_keylist_nextnode (keylist_t * keylist)
+int
+vconf_get_int (const char *keyname, int *intval)
 {
-  keynode_t *result;
-
-  retvm_if (keylist == NULL, NULL, "Invalid argument: keylist is NULL");
+  struct singleton single;
+  int status;
 
-  result = keylist->cursor;
-  result = result == NULL ? keylist->head : result->next;
-  keylist->cursor = result;
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  return result;
+  status = _keylist_init_singleton_ (&single, keyname, type_int);
+  if (status == VCONF_OK)
+    {
+      status = _get_singleton_ (NULL, &single);
+      if (status == VCONF_OK)
+	*intval = single.node.value.i;
+    }
+  return status;
 }
 
 int
-vconf_keylist_lookup (keylist_t * keylist,
-		      const char *keyname, keynode_t ** return_node)
+vconf_set_label (const char *keyname, const char *label)
 {
-  keynode_t *keynode;
-
-  retvm_if (keylist == NULL,
-	    VCONF_ERROR, "Invalid argument: keylist is NULL");
-  retvm_if (keyname == NULL,
-	    VCONF_ERROR, "Invalid argument: keyname is NULL");
-  retvm_if (return_node == NULL,
-	    VCONF_ERROR, "Invalid argument: return_node is NULL");
+  struct singleton single;
+  int status;
 
-  keynode = _keylist_lookup_ (keylist, keyname, NULL);
-  if (NULL == keynode)
-    return 0;
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  if (return_node)
-    *return_node = keynode;
-  return keynode->type;
-}
+  retvm_if (label == NULL, VCONF_ERROR, "Invalid argument: name is NULL");
 
-static int
-_cb_sort_keynodes (const void *a, const void *b)
-{
-  register const keynode_t *kna = *(const keynode_t **) a;
-  register const keynode_t *knb = *(const keynode_t **) b;
-  return strcmp (kna->keyname, knb->keyname);
+  status = _keylist_init_singleton_ (&single, keyname, type_unset);
+  if (status == VCONF_OK)
+    {
+      status = vconf_set_labels (&single.list, label);
+    }
+  return status;
 }
 
 int
-vconf_keylist_sort (keylist_t * keylist)
+vconf_get_bool (const char *keyname, int *boolval)
 {
-  int index;
-  keynode_t **nodes, *keynode;
-
-  retvm_if (keylist == NULL,
-	    VCONF_ERROR, "Invalid argument: keylist is NULL");
-
-  if (keylist->num <= 1)
-    return VCONF_OK;
+  struct singleton single;
+  int status;
 
-  nodes = malloc (keylist->num * sizeof *nodes);
-  retvm_if (nodes == NULL, VCONF_ERROR, "can't allocate memory for sorting");
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  index = 0;
-  keynode = keylist->head;
-  while (keynode != NULL)
+  status = _keylist_init_singleton_ (&single, keyname, type_bool);
+  if (status == VCONF_OK)
     {
-      assert (index < keylist->num);
-      nodes[index++] = keynode;
-      keynode = keynode->next;
+      status = _get_singleton_ (NULL, &single);
+      if (status == VCONF_OK)
+	*boolval = (int) single.node.value.b;
     }
-  assert (index == keylist->num);
+  return status;
+}
 
-  qsort (nodes, index, sizeof *nodes, _cb_sort_keynodes);
+int
+vconf_get_dbl (const char *keyname, double *dblval)
+{
+  struct singleton single;
+  int status;
 
-  while (index)
+  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
+
+  status = _keylist_init_singleton_ (&single, keyname, type_double);
+  if (status == VCONF_OK)
     {
-      nodes[--index]->next = keynode;
-      keynode = nodes[index];
+      status = _get_singleton_ (NULL, &single);
+      if (status == VCONF_OK)
+	*dblval = single.node.value.d;
     }
-  keylist->head = keynode;
-  free (nodes);
-  return VCONF_OK;
+  return status;
 }
 
-int
-vconf_keylist_add_int (keylist_t * keylist, const char *keyname,
-		       const int value)
+char *
+vconf_get_str (const char *keyname)
 {
-  keynode_t *keynode;
+  struct singleton single;
+  int status;
 
-  retvm_if (keylist == NULL,
-	    VCONF_ERROR, "Invalid argument: keylist is NULL");
-  retvm_if (keyname == NULL,
-	    VCONF_ERROR, "Invalid argument: keyname is NULL");
+  retvm_if (keyname == NULL, NULL, "Invalid argument: key is NULL");
 
-  keynode = _keylist_getadd_ (keylist, keyname, type_int);
-  if (keynode == NULL)
-    return VCONF_ERROR;
+  status = _keylist_init_singleton_ (&single, keyname, type_string);
+  if (status != VCONF_OK)
+    return NULL;
 
-  keynode->value.i = value;
-  return keylist->num;
+  single.node.value.s = NULL;
+  status = _get_singleton_ (NULL, &single);
+  if (status != VCONF_OK)
+    return NULL;
+
+  return single.node.value.s;
 }
 
-int
-vconf_keylist_add_bool (keylist_t * keylist, const char *keyname,
-			const int value)
+vconf_key_t *
+vconf_key_open (const char *keyname)
 {
-  keynode_t *keynode;
-
-  retvm_if (keylist == NULL,
-	    VCONF_ERROR, "Invalid argument: keylist is NULL");
-  retvm_if (keyname == NULL,
-	    VCONF_ERROR, "Invalid argument: keyname is NULL");
+  vconf_key_t *result;
+  struct layer_key laykey;
+  size_t length, glength;
+  char *name;
 
-  keynode = _keylist_getadd_ (keylist, keyname, type_bool);
-  if (keynode == NULL)
-    return VCONF_ERROR;
+  retvm_if (keyname == NULL, NULL, "Invalid argument: key is NULL");
+  length = _check_keyname_ (keyname);
+  retvm_if (!length, NULL, "Invalid key name(%s)", keyname);
+  retvm_if (length > keyname_maximum_length, NULL, "keyname too long");
+  if (_get_layer_key_ (keyname, &laykey) != VCONF_OK)
+    return NULL;
+  if (_ensure_default_group_ () != VCONF_OK)
+    return NULL;
 
-  keynode->value.b = !!value;
-  return keylist->num;
+  LOCK (group);
+  glength = strlen (default_group);
+  result = calloc (1, 2 + length + glength + sizeof *result);
+  if (result != NULL)
+    {
+      name = (char *) (result + 1);
+      memcpy (name, keyname, length + 1);
+      result->keyname = name;
+      name += length + 1;
+      memcpy (name, default_group, glength + 1);
+      result->group = name;
+      result->hash = _hash_name_ (keyname);
+    }
+  UNLOCK (group);
+  retvm_if (result == NULL, NULL, "allocation of prepared key failed");
+  return result;
 }
 
 int
-vconf_keylist_add_dbl (keylist_t * keylist,
-		       const char *keyname, const double value)
+vconf_key_close (vconf_key_t * key)
 {
-  keynode_t *keynode;
-
-  retvm_if (keylist == NULL, VCONF_ERROR,
-	    "Invalid argument: keylist is NULL");
-  retvm_if (keyname == NULL, VCONF_ERROR,
-	    "Invalid argument: keyname is NULL");
+  enum keytype type;
 
-  keynode = _keylist_getadd_ (keylist, keyname, type_double);
-  if (keynode == NULL)
-    return VCONF_ERROR;
+  retvm_if (key == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  keynode->value.d = value;
-  return keylist->num;
+  for (type = type_string; type <= type_bool; type++)
+    if (key->keys[type] != NULL)
+      _release_buxton_key_ (key->keys[type]);
+  free (key);
+  return VCONF_OK;
 }
 
-int
-vconf_keylist_add_str (keylist_t * keylist,
-		       const char *keyname, const char *value)
+/*
+ * get the buxton key of 'key' for 'type', creating it at its first use.
+ * The keys of the prepared keys aren't in the cache of buxton keys so
+ * that they don't evict the other ones.
+ */
+static struct keycache *
+_key_get_buxton_key_ (vconf_key_t * key, enum keytype type)
 {
-  keynode_t *keynode;
-  char *copy;
-
-  retvm_if (keylist == NULL, VCONF_ERROR,
-	    "Invalid argument: keylist is NULL");
-  retvm_if (keyname == NULL, VCONF_ERROR,
-	    "Invalid argument: keyname is NULL");
+  struct keycache *entry, *installed;
 
-  copy = strdup (value == NULL ? "" : value);
-  retvm_if (copy == NULL, VCONF_ERROR, "Allocation of memory failed");
+  entry = __atomic_load_n (&key->keys[type], __ATOMIC_ACQUIRE);
+  if (entry != NULL)
+    return entry;
 
-  keynode = _keylist_getadd_ (keylist, keyname, type_string);
-  if (keynode == NULL)
+  entry = calloc (1, sizeof *entry);
+  retvm_if (entry == NULL, NULL, "Can't allocate memory for the buxton key");
+  entry->key = _create_buxton_key_ (key->keyname, type, key->group);
+  if (entry->key == NULL)
     {
-      free (copy);
-      return VCONF_ERROR;
+      free (entry);
+      return NULL;
     }
+  STAT_INC (keys_created);
+  entry->keyname = key->keyname;
+  entry->hash = key->hash;
+  entry->type = type;
+  entry->refcount = 1;
 
-  free (keynode->value.s);
-  keynode->value.s = copy;
-  return keylist->num;
+  /*
+   * an other thread using the same prepared key may have been faster 
+   */
+  installed = NULL;
+  if (!__atomic_compare_exchange_n (&key->keys[type], &installed, entry, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      _keycache_free_ (entry);
+      entry = installed;
+    }
+  return entry;
 }
 
-int
-vconf_keylist_add_null (keylist_t * keylist, const char *keyname)
+/*
+ * get the value of 'keynode' from the entry of the shared cache linked
+ * to 'key', avoiding the lookup by name.
+ * returns 1 if found or 0 otherwise.
+ */
+static int
+_key_cache_get_ (vconf_key_t * key, keynode_t * keynode)
 {
-  keynode_t *keynode;
+  int result;
 
-  retvm_if (keylist == NULL, VCONF_ERROR,
-	    "Invalid argument: keylist is NULL");
-  retvm_if (keyname == NULL, VCONF_ERROR,
-	    "Invalid argument: keyname is NULL");
+  if (__atomic_load_n (&key->entry, __ATOMIC_RELAXED) == NULL)
+    return 0;
 
-  keynode = _keylist_getadd_ (keylist, keyname, type_unset);
-  if (keynode == NULL)
-    return VCONF_ERROR;
+  _cache_sync_ (&the_cache);
+  LOCK (cache);
+  result = key->generation == the_cache.generation
+    && _cache_entry_get_ (key->entry, keynode);
+  UNLOCK (cache);
 
-  return keylist->num;
+  if (result)
+    STAT_INC (cache_hits);
+  return result;
 }
 
-int
-vconf_keylist_del (keylist_t * keylist, const char *keyname)
+/*
+ * links 'key' to its entry of the shared cache if any
+ */
+static void
+_key_cache_link_ (vconf_key_t * key)
 {
-  keynode_t *keynode, **previous = NULL;
-
-  retvm_if (keylist == NULL, VCONF_ERROR,
-	    "Invalid argument: keylist is NULL");
-  retvm_if (keyname == NULL, VCONF_ERROR,
-	    "Invalid argument: keyname is NULL");
+  if (the_cache.count == 0)
+    return;
 
-  keynode = _keylist_lookup_ (keylist, keyname, &previous);
-  if (keynode == NULL)
-    return VCONF_ERROR;
+  LOCK (cache);
+  if (key->entry == NULL || key->generation != the_cache.generation)
+    {
+      __atomic_store_n (&key->entry,
+			_cache_lookup_ (&the_cache, key->keyname, key->hash),
+			__ATOMIC_RELAXED);
+      key->generation = the_cache.generation;
+    }
+  UNLOCK (cache);
+}
 
-  *previous = keynode->next;
-  keylist->num--;
-  _keynode_free_ (keynode);
+static inline int
+_key_init_singleton_ (struct singleton *singleton, vconf_key_t * key,
+		      enum keytype type)
+{
+  if (_key_get_buxton_key_ (key, type) == NULL)
+    return VCONF_ERROR;
 
+  memset (singleton, 0, sizeof *singleton);
+  singleton->list.num = 1;
+  singleton->list.head = &singleton->node;
+  singleton->list.keys = key->keys;
+  singleton->node.keyname = key->keyname;
+  singleton->node.type = type;
+  singleton->node.list = &singleton->list;
   return VCONF_OK;
 }
 
-int
-vconf_set (keylist_t * keylist)
+/*
+ * get the value of the prepared 'key' into 'single', using first the
+ * entry of the shared cache linked to it
+ */
+static int
+_key_get_singleton_ (vconf_key_t * key, struct singleton *single)
 {
-  retvm_if (keylist == NULL, VCONF_ERROR,
-	    "Invalid argument: keylist is NULL");
+  int status;
+
+  if (_key_cache_get_ (key, &single->node))
+    return VCONF_OK;
 
-  return _apply_buxton_on_list_ (keylist, _async_set_or_unset_, NULL);
+  status = _get_singleton_ (NULL, single);
+  if (status == VCONF_OK)
+    _key_cache_link_ (key);
+  return status;
 }
 
 int
-vconf_set_labels (keylist_t * keylist, const char *label)
+vconf_key_get_int (vconf_key_t * key, int *intval)
 {
-  retvm_if (keylist == NULL, VCONF_ERROR,
-	    "Invalid argument: keylist is NULL");
+  struct singleton single;
+  int status;
 
-  retvm_if (label == NULL, VCONF_ERROR, "Invalid argument: name is NULL");
+  retvm_if (key == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  return _apply_buxton_on_list_ (keylist, _async_set_label_, label);
+  status = _key_init_singleton_ (&single, key, type_int);
+  if (status == VCONF_OK)
+    {
+      status = _key_get_singleton_ (key, &single);
+      if (status == VCONF_OK)
+	*intval = single.node.value.i;
+    }
+  return status;
 }
 
 int
-vconf_sync_key (const char *keyname)
+vconf_key_get_bool (vconf_key_t * key, int *boolval)
 {
-  /*
-   * does nothing succefully 
-   */
-  return 0;
-}
+  struct singleton single;
+  int status;
 
-int
-vconf_refresh (keylist_t * keylist)
-{
-  retvm_if (keylist == NULL, VCONF_ERROR,
-	    "Invalid argument: keylist is NULL");
+  retvm_if (key == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  return _apply_buxton_on_list_ (keylist, _async_refresh_, NULL);
+  status = _key_init_singleton_ (&single, key, type_bool);
+  if (status == VCONF_OK)
+    {
+      status = _key_get_singleton_ (key, &single);
+      if (status == VCONF_OK)
+	*boolval = (int) single.node.value.b;
+    }
+  return status;
 }
 
 int
-vconf_scan (keylist_t * keylist, const char *dirpath, get_option_t option)
+vconf_key_get_dbl (vconf_key_t * key, double *dblval)
 {
-  char *dircopy;
-  struct layer_key laykey;
-  struct scanning_data data;
+  struct singleton single;
   int status;
 
-  retvm_if (keylist == NULL, VCONF_ERROR,
-	    "Invalid argument: keylist is null");
-  retvm_if (keylist->num != 0, VCONF_ERROR,
-	    "Invalid argument: keylist not empty");
-  retvm_if (dirpath == NULL, VCONF_ERROR,
-	    "Invalid argument: dirpath is null");
-  retvm_if (_check_keyname_ (dirpath) == 0, VCONF_ERROR,
-	    "Invalid argument: dirpath is not valid");
+  retvm_if (key == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  status = _open_buxton_ ();
-  if (!status)
+  status = _key_init_singleton_ (&single, key, type_double);
+  if (status == VCONF_OK)
     {
-      ERR ("Can't connect to buxton");
-      return VCONF_ERROR;
+      status = _key_get_singleton_ (key, &single);
+      if (status == VCONF_OK)
+	*dblval = single.node.value.d;
     }
+  return status;
+}
 
-  data.keylist = keylist;
+char *
+vconf_key_get_str (vconf_key_t * key)
+{
+  struct singleton single;
+  int status;
 
-  switch (option)
-    {
-    case VCONF_GET_KEY:
-      data.want_directories = 0;
-      data.want_keys = 1;
-      data.is_recursive = 0;
-      break;
-    case VCONF_GET_ALL:
-      data.want_directories = 1;
-      data.want_keys = 1;
-      data.is_recursive = 0;
-      break;
-    case VCONF_GET_DIR:
-      data.want_directories = 1;
-      data.want_keys = 0;
-      data.is_recursive = 0;
-      break;
-    case VCONF_GET_KEY_REC:
-      data.want_directories = 0;
-      data.want_keys = 1;
-      data.is_recursive = 1;
-      break;
-    case VCONF_GET_ALL_REC:
-      data.want_directories = 1;
-      data.want_keys = 1;
-      data.is_recursive = 1;
-      break;
-    case VCONF_GET_DIR_REC:
-      data.want_directories = 0;
-      data.want_keys = 1;
-      data.is_recursive = 1;
-      break;
-    default:
-      ERR ("Invalid argument: Bad option value");
-      return VCONF_ERROR;
-    }
+  retvm_if (key == NULL, NULL, "Invalid argument: key is NULL");
 
-  data.dirlen = strlen (dirpath);
-  assert (data.dirlen);
-  if (dirpath[data.dirlen - 1] == '/')
-    {
-      data.directory = dirpath;
-      dircopy = NULL;
-    }
-  else
-    {
-      status = asprintf (&dircopy, "%s/", dirpath);
-      retvm_if (status < 0, VCONF_ERROR,
-		"No more memory for copying dirpath");
-      data.directory = dircopy;
-      data.dirlen++;
-    }
+  status = _key_init_singleton_ (&single, key, type_string);
+  if (status != VCONF_OK)
+    return NULL;
 
-  status = _get_layer_key_ (data.directory, &laykey);
+  status = _key_get_singleton_ (key, &single);
   if (status != VCONF_OK)
-    {
-      return status;
-    }
+    return NULL;
 
-  data.prefix = laykey.prefix;
-  if (!laykey.key[0])
-    {
-      laykey.key = NULL;
-    }
+  return single.node.value.s;
+}
 
-  data.pending = 1;
-  assert (_buxton_ () != NULL);
-  status = buxton_list_names (_buxton_ (), laykey.layer, default_group,
-			      laykey.key, (BuxtonCallback) _cb_scan_,
-			      &data, false);
-  if (!status)
-    status = _wait_buxton_response_ (&data.pending);
+int
+vconf_key_set_int (vconf_key_t * key, const int intval)
+{
+  struct singleton single;
 
-  free (dircopy);
+  retvm_if (key == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  retvm_if (status, VCONF_ERROR, "Error while calling buxton_list_names: %m");
-  if (data.cb_status != VCONF_OK)
-    {
-      return VCONF_ERROR;
-    }
+  if (_key_init_singleton_ (&single, key, type_int) != VCONF_OK)
+    return VCONF_ERROR;
+  single.node.value.i = intval;
+  return vconf_set (&single.list);
+}
+
+int
+vconf_key_set_bool (vconf_key_t * key, const int boolval)
+{
+  struct singleton single;
 
-  return vconf_refresh (keylist);
+  retvm_if (key == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
+
+  if (_key_init_singleton_ (&single, key, type_bool) != VCONF_OK)
+    return VCONF_ERROR;
+  single.node.value.b = (bool) boolval;
+  return vconf_set (&single.list);
 }
 
 int
-vconf_get (keylist_t * keylist, const char *dirpath, get_option_t option)
+vconf_key_set_dbl (vconf_key_t * key, const double dblval)
 {
-  if (option == VCONF_REFRESH_ONLY
-      || (option == VCONF_GET_KEY && keylist->num != 0))
-    {
-      return vconf_refresh (keylist);
-    }
-  else
-    {
-      return vconf_scan (keylist, dirpath, option);
-    }
+  struct singleton single;
+
+  retvm_if (key == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
+
+  if (_key_init_singleton_ (&single, key, type_double) != VCONF_OK)
+    return VCONF_ERROR;
+  single.node.value.d = dblval;
+  return vconf_set (&single.list);
 }
 
 int
-vconf_unset (const char *keyname)
+vconf_key_set_str (vconf_key_t * key, const char *strval)
 {
   struct singleton single;
-  int status;
 
-  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
+  retvm_if (key == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
-  status = _keylist_init_singleton_ (&single, keyname, type_delete);
-  if (status == VCONF_OK)
-    {
-      status = vconf_set (&single.list);
-    }
-  return status;
+  if (_key_init_singleton_ (&single, key, type_string) != VCONF_OK)
+    return VCONF_ERROR;
+  single.node.value.s = (char *) strval;
+  return vconf_set (&single.list);
+}
 
+int
+vconf_get_many (vconf_desc_t * descs, unsigned count)
+{
+  return vconf_get_many_timed (descs, count, _default_timeout_ ());
 }
 
 int
-vconf_exists (const char *keyname)
+vconf_get_many_timed (vconf_desc_t * descs, unsigned count, int timeout)
 {
-  struct singleton single;
-  int status;
+  keylist_t list;
+  keynode_t *nodes, *node;
+  unsigned index;
+  int status, pass, shared;
+  struct timespec deadline;
+
+  retvm_if (descs == NULL && count != 0, VCONF_ERROR,
+	    "Invalid argument: descs is NULL");
+  if (count == 0)
+    return VCONF_OK;
 
-  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
+  status = _ensure_default_group_ ();
+  if (status != VCONF_OK)
+    return status;
 
-  status = _keylist_init_singleton_ (&single, keyname, type_unset);
-  if (status == VCONF_OK)
+  nodes = calloc (count, sizeof *nodes);
+  retvm_if (nodes == NULL, VCONF_ERROR, "Allocation of memory failed");
+
+  /*
+   * answer from the cache and list the keys to read 
+   */
+  memset (&list, 0, sizeof list);
+  shared = 0;
+  for (index = count; index-- > 0;)
     {
-      status = vconf_refresh (&single.list);
-      if (status == VCONF_OK && single.node.type == type_string)
-	free (single.node.value.s);
+      node = &nodes[index];
+      node->keyname = descs[index].keyname;
+      node->type = _keytype_of_vconf_type_ (descs[index].type);
+      node->list = &list;
+      node->status = VCONF_ERROR;
+      if (node->keyname == NULL || node->type == type_unset
+	  || descs[index].value == NULL || !_check_keyname_ (node->keyname))
+	{
+	  ERR ("Invalid descriptor %u", index);
+	  continue;
+	}
+      if (_cache_get_ (&the_cache, node))
+	{
+	  node->status = VCONF_OK;
+	  continue;
+	}
+      shared |= _cache_prepare_ (&the_cache, node->keyname);
+      node->next = list.head;
+      list.head = node;
+      list.num++;
+    }
+
+  /*
+   * read the missing values in one pass 
+   */
+  pass = VCONF_OK;
+  if (list.num != 0)
+    {
+      pass = _refresh_ (NULL, &list, shared,
+			_deadline_ (&deadline, timeout));
+      for (node = list.head; node != NULL; node = node->next)
+	if (node->status == VCONF_OK)
+	  _cache_put_ (&the_cache, node, 0);
+    }
+
+  status = VCONF_OK;
+  for (index = 0; index < count; index++)
+    {
+      node = &nodes[index];
+      if (node->status == VCONF_OK
+	  && node->type != _keytype_of_vconf_type_ (descs[index].type))
+	{
+	  ERR ("Bad type for key %s", node->keyname);
+	  node->status = VCONF_ERROR;
+	}
+      descs[index].status = node->status;
+      if (node->status != VCONF_OK)
+	{
+	  if (node->type == type_string)
+	    free (node->value.s);
+	  status = VCONF_ERROR;
+	  continue;
+	}
+      switch (node->type)
+	{
+	case type_string:
+	  *(char **) descs[index].value = node->value.s;
+	  break;
+	case type_int:
+	  *(int *) descs[index].value = node->value.i;
+	  break;
+	case type_double:
+	  *(double *) descs[index].value = node->value.d;
+	  break;
+	case type_bool:
+	  *(int *) descs[index].value = (int) node->value.b;
+	  break;
+	default:
+	  break;
+	}
     }
-  return status;
 
+  free (nodes);
+  return pass == VCONF_ERROR_TIMEOUT ? pass : status;
 }
 
 int
-vconf_unset_recursive (const char *in_dir)
+vconf_get_ext_errno (void)
 {
-  struct _keylist_t *keylist;
-  struct _keynode_t *keynode;
-  int status;
+  INFO("vconf errno: %d", g_vconf_errno);
+  return g_vconf_errno;
+}
 
-  retvm_if (in_dir == NULL, VCONF_ERROR, "Invalid argument: dir is null");
+vconf_ctx_t *
+vconf_ctx_new ()
+{
+  vconf_ctx_t *ctx;
 
-  keylist = vconf_keylist_new ();
-  if (keylist == NULL)
-    return VCONF_ERROR;
+  if (_ensure_default_group_ () != VCONF_OK)
+    return NULL;
 
-  status = vconf_scan (keylist, in_dir, VCONF_GET_KEY_REC);
-  if (status == VCONF_OK)
+  ctx = calloc (1, sizeof *ctx);
+  retvm_if (ctx == NULL, NULL, "Allocation of memory failed");
+
+  LOCK (group);
+  ctx->group = strdup (default_group);
+  UNLOCK (group);
+  if (ctx->group == NULL)
     {
-      for (keynode = keylist->head; keynode; keynode = keynode->next)
-	keynode->type = type_delete;
-      status = vconf_set (keylist);
+      ERR ("Allocation of memory failed");
+      free (ctx);
+      return NULL;
     }
-  vconf_keylist_free (keylist);
-  return status;
+
+  LOCK (buxton);
+  ctx->cache.capacity = the_cache.capacity;
+  UNLOCK (buxton);
+  ctx->cache.ctx = ctx;
+  return ctx;
 }
 
 int
-vconf_notify_key_changed (const char *keyname, vconf_callback_fn cb,
-			  void *user_data)
+vconf_ctx_free (vconf_ctx_t * ctx)
 {
-  int status;
-  struct notify *notif;
-  keynode_t *keynode, *aknode;
-  keylist_t *alist;
-
-  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is null");
-  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
-  status = _open_buxton_ ();
-  retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
-  status = vconf_exists (keyname);
-  retvm_if (status != VCONF_OK, VCONF_ERROR, "key %s doesn't exist", keyname);
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
 
+  _ctx_drop_ (ctx);
+  free (ctx->group);
+  free (ctx);
+  return VCONF_OK;
+}
 
-  /*
-   * create the notification 
-   */
-  notif = malloc (sizeof *notif);
-  retvm_if (notif == NULL, VCONF_ERROR,
-	    "Allocation of notify structure failed");
+int
+vconf_ctx_set_default_group (vconf_ctx_t * ctx, const char *groupname)
+{
+  char *copy;
 
-  /*
-   * ensure existing list 
-   */
-  LOCK (notify);
-  if (notify_keylist == NULL)
-    {
-      notify_keylist = vconf_keylist_new ();
-      if (notify_keylist == NULL)
-	{
-	  UNLOCK (notify);
-	  free (notif);
-	  return VCONF_ERROR;
-	}
-    }
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
 
-  /*
-   * search keynode of keyname 
-   */
-  keynode = _keylist_lookup_ (notify_keylist, keyname, NULL);
-  if (keynode == NULL)
-    {
-      /*
-       * not found, create it with type unset 
-       */
-      keynode = _keylist_add_ (notify_keylist, keyname, type_unset);
-      if (keynode == NULL)
-	{
-	  UNLOCK (notify);
-	  free (notif);
-	  return VCONF_ERROR;
-	}
-    }
+  copy = _dup_groupname_ (groupname);
+  if (copy == NULL)
+    return VCONF_ERROR;
 
   /*
-   * init the notification 
+   * the cached values are bound to the previous group 
    */
-  notif->callback = cb;
-  notif->userdata = user_data;
-  notif->keynode = keynode;
-  notif->next = notify_entries;
-  notify_entries = notif;
-  UNLOCK (notify);
+  _cache_flush_ (&ctx->cache);
+  free (ctx->group);
+  ctx->group = copy;
+  return VCONF_OK;
+}
 
-  /*
-   * record the notification 
-   */
-  status = _notify_reg_unreg_ (notif, true);
-  if (status != VCONF_OK)
-    {
-      vconf_ignore_key_changed (keyname, cb);
-      return VCONF_ERROR;
-    }
+int
+vconf_ctx_set_cache_capacity (vconf_ctx_t * ctx, unsigned capacity)
+{
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
 
-#if !defined(NO_GLIB)
-  return _glib_start_watch_ ();
-#else
+  _cache_flush_ (&ctx->cache);
+  ctx->cache.capacity = capacity;
   return VCONF_OK;
-#endif
 }
 
 int
-vconf_ignore_key_changed (const char *keyname, vconf_callback_fn cb)
+vconf_ctx_get_ext_errno (vconf_ctx_t * ctx)
 {
-  struct notify *entry, **prevent, *delent, **prevdelent;
-  keynode_t *keynode, **prevnod;
-  int fcount;
-  int status;
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
 
-  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is null");
-  retvm_if (cb == NULL, VCONF_ERROR, "Invalid argument: cb(%p)", cb);
-  status = _open_buxton_ ();
-  retvm_if (!status, VCONF_ERROR, "Can't connect to buxton");
+  return ctx->error;
+}
 
-  fcount = 0;
-  status = VCONF_ERROR;
-  delent = NULL;
+int
+vconf_ctx_set (vconf_ctx_t * ctx, keylist_t * keylist)
+{
+  struct timespec deadline;
 
-  LOCK (notify);
-  if (notify_keylist != NULL)
-    {
-      keynode = _keylist_lookup_ (notify_keylist, keyname, &prevnod);
-      if (keynode != NULL)
-	{
-	  prevdelent = &delent;
-	  prevent = &notify_entries;
-	  entry = notify_entries;
-	  while (entry != NULL)
-	    {
-	      if (entry->keynode == keynode)
-		{
-		  if (entry->callback == cb)
-		    {
-		      *prevdelent = entry;
-		      prevdelent = &entry->next;
-		      entry = entry->next;
-		      continue;
-		    }
-		  fcount++;
-		}
-	      *prevent = entry;
-	      prevent = &entry->next;
-	      entry = entry->next;
-	    }
-	  *prevent = NULL;
-	  *prevdelent = NULL;
-	  if (fcount == 0)
-	    *prevnod = keynode->next;
-#if !defined(NO_GLIB)
-	  if (notify_entries == NULL)
-	    _glib_stop_watch_ ();
-#endif
-	  if (delent != NULL)
-	    {
-	      UNLOCK (notify);
-	      while (delent != NULL)
-		{
-		  entry = delent;
-		  delent = entry->next;
-		  _notify_reg_unreg_ (entry, false);
-		  free (entry);
-		}
-	      if (fcount == 0)
-		_keynode_free_ (keynode);
-	      return VCONF_OK;
-	    }
-	}
-    }
-  UNLOCK (notify);
-  ERR ("Not found: can't remove notification for key(%s)", keyname);
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
 
-  return VCONF_ERROR;
+  return _set_ (ctx, keylist, _deadline_ (&deadline, _default_timeout_ ()));
 }
 
 int
-vconf_set_int (const char *keyname, const int intval)
+vconf_ctx_refresh (vconf_ctx_t * ctx, keylist_t * keylist)
+{
+  struct timespec deadline;
+
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
+
+  return _refresh_ (ctx, keylist, 0,
+		    _deadline_ (&deadline, _default_timeout_ ()));
+}
+
+int
+vconf_ctx_set_int (vconf_ctx_t * ctx, const char *keyname, const int intval)
 {
   struct singleton single;
   int status;
@@ -1940,13 +6962,14 @@ vconf_set_int (const char *keyname, const int intval)
   if (status == VCONF_OK)
     {
       single.node.value.i = intval;
-      status = vconf_set (&single.list);
+      status = vconf_ctx_set (ctx, &single.list);
     }
   return status;
 }
 
 int
-vconf_set_bool (const char *keyname, const int boolval)
+vconf_ctx_set_bool (vconf_ctx_t * ctx, const char *keyname,
+		    const int boolval)
 {
   struct singleton single;
   int status;
@@ -1957,13 +6980,14 @@ vconf_set_bool (const char *keyname, const int boolval)
   if (status == VCONF_OK)
     {
       single.node.value.b = (bool) boolval;
-      status = vconf_set (&single.list);
+      status = vconf_ctx_set (ctx, &single.list);
     }
   return status;
 }
 
 int
-vconf_set_dbl (const char *keyname, const double dblval)
+vconf_ctx_set_dbl (vconf_ctx_t * ctx, const char *keyname,
+		   const double dblval)
 {
   struct singleton single;
   int status;
@@ -1974,13 +6998,14 @@ vconf_set_dbl (const char *keyname, const double dblval)
   if (status == VCONF_OK)
     {
       single.node.value.d = dblval;
-      status = vconf_set (&single.list);
+      status = vconf_ctx_set (ctx, &single.list);
     }
   return status;
 }
 
 int
-vconf_set_str (const char *keyname, const char *strval)
+vconf_ctx_set_str (vconf_ctx_t * ctx, const char *keyname,
+		   const char *strval)
 {
   struct singleton single;
   int status;
@@ -1991,23 +7016,24 @@ vconf_set_str (const char *keyname, const char *strval)
   if (status == VCONF_OK)
     {
       single.node.value.s = (char *) strval;
-      status = vconf_set (&single.list);
+      status = vconf_ctx_set (ctx, &single.list);
     }
   return status;
 }
 
 int
-vconf_get_int (const char *keyname, int *intval)
+vconf_ctx_get_int (vconf_ctx_t * ctx, const char *keyname, int *intval)
 {
   struct singleton single;
   int status;
 
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
   retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
   status = _keylist_init_singleton_ (&single, keyname, type_int);
   if (status == VCONF_OK)
     {
-      status = vconf_refresh (&single.list);
+      status = _get_singleton_ (ctx, &single);
       if (status == VCONF_OK)
 	*intval = single.node.value.i;
     }
@@ -2015,35 +7041,18 @@ vconf_get_int (const char *keyname, int *intval)
 }
 
 int
-vconf_set_label (const char *keyname, const char *label)
-{
-  struct singleton single;
-  int status;
-
-  retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
-
-  retvm_if (label == NULL, VCONF_ERROR, "Invalid argument: name is NULL");
-
-  status = _keylist_init_singleton_ (&single, keyname, type_unset);
-  if (status == VCONF_OK)
-    {
-      status = vconf_set_labels (&single.list, label);
-    }
-  return status;
-}
-
-int
-vconf_get_bool (const char *keyname, int *boolval)
+vconf_ctx_get_bool (vconf_ctx_t * ctx, const char *keyname, int *boolval)
 {
   struct singleton single;
   int status;
 
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
   retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
   status = _keylist_init_singleton_ (&single, keyname, type_bool);
   if (status == VCONF_OK)
     {
-      status = vconf_refresh (&single.list);
+      status = _get_singleton_ (ctx, &single);
       if (status == VCONF_OK)
 	*boolval = (int) single.node.value.b;
     }
@@ -2051,17 +7060,18 @@ vconf_get_bool (const char *keyname, int *boolval)
 }
 
 int
-vconf_get_dbl (const char *keyname, double *dblval)
+vconf_ctx_get_dbl (vconf_ctx_t * ctx, const char *keyname, double *dblval)
 {
   struct singleton single;
   int status;
 
+  retvm_if (ctx == NULL, VCONF_ERROR, "Invalid argument: ctx is NULL");
   retvm_if (keyname == NULL, VCONF_ERROR, "Invalid argument: key is NULL");
 
   status = _keylist_init_singleton_ (&single, keyname, type_double);
   if (status == VCONF_OK)
     {
-      status = vconf_refresh (&single.list);
+      status = _get_singleton_ (ctx, &single);
       if (status == VCONF_OK)
 	*dblval = single.node.value.d;
     }
@@ -2069,11 +7079,12 @@ vconf_get_dbl (const char *keyname, double *dblval)
 }
 
 char *
-vconf_get_str (const char *keyname)
+vconf_ctx_get_str (vconf_ctx_t * ctx, const char *keyname)
 {
   struct singleton single;
   int status;
 
+  retvm_if (ctx == NULL, NULL, "Invalid argument: ctx is NULL");
   retvm_if (keyname == NULL, NULL, "Invalid argument: key is NULL");
 
   status = _keylist_init_singleton_ (&single, keyname, type_string);
@@ -2081,7 +7092,7 @@ vconf_get_str (const char *keyname)
     return NULL;
 
   single.node.value.s = NULL;
-  status = vconf_refresh (&single.list);
+  status = _get_singleton_ (ctx, &single);
   if (status != VCONF_OK)
     return NULL;
 
@@ -2089,8 +7100,267 @@ vconf_get_str (const char *keyname)
 }
 
 int
-vconf_get_ext_errno (void)
+vconf_set_cache_capacity (unsigned capacity)
 {
-  INFO("vconf errno: %d", g_vconf_errno);
-  return g_vconf_errno;
+  LOCK (buxton);
+  _cache_flush_ (&the_cache);
+  the_cache.capacity = capacity;
+  UNLOCK (buxton);
+  _deliver_events_ ();
+  _check_close_buxton_ ();
+  return VCONF_OK;
+}
+
+int
+vconf_set_connection_policy (vconf_connection_policy_t policy,
+			     unsigned idle_period)
+{
+  switch (policy)
+    {
+    case VCONF_CONNECTION_CLOSE:
+    case VCONF_CONNECTION_KEEP:
+      break;
+    case VCONF_CONNECTION_IDLE:
+      retvm_if (idle_period == 0, VCONF_ERROR,
+		"Invalid argument: idle_period is 0");
+      break;
+    default:
+      ERR ("Invalid argument: Bad policy value");
+      return VCONF_ERROR;
+    }
+
+  LOCK (buxton);
+  connection_policy = policy;
+  connection_idle_period = idle_period;
+  UNLOCK (buxton);
+  _check_close_buxton_ ();
+  return VCONF_OK;
+}
+
+int
+vconf_set_timeout (int timeout)
+{
+  __atomic_store_n (&default_timeout, timeout < 0 ? -1 : timeout,
+		    __ATOMIC_RELAXED);
+  return VCONF_OK;
+}
+
+int
+vconf_set_connection_pool (unsigned size)
+{
+  struct connection *closed, *next;
+
+  closed = NULL;
+  LOCK (pool);
+  pool_size = size;
+  while (pool_free != NULL && pool_count > size)
+    {
+      next = pool_free->next;
+      pool_free->next = closed;
+      closed = pool_free;
+      pool_free = next;
+      pool_count--;
+    }
+  UNLOCK (pool);
+
+  while (closed != NULL)
+    {
+      next = closed->next;
+      buxton_close (closed->client);
+      free (closed);
+      closed = next;
+    }
+  return VCONF_OK;
+}
+
+int
+vconf_set_pipeline_window (unsigned window)
+{
+  retvm_if (window == 0, VCONF_ERROR, "Invalid argument: window is 0");
+
+  LOCK (buxton);
+  pipeline_window = window;
+  UNLOCK (buxton);
+  return VCONF_OK;
+}
+
+int
+vconf_set_dispatch_budget (unsigned budget)
+{
+  retvm_if (budget == 0, VCONF_ERROR, "Invalid argument: budget is 0");
+
+  LOCK (buxton);
+  dispatch_budget = budget;
+  UNLOCK (buxton);
+  return VCONF_OK;
+}
+
+int
+vconf_set_notify_workers (unsigned count)
+{
+#if !defined(NO_MULTITHREADING)
+  static int changing = 0;
+  pthread_t *threads;
+  unsigned index;
+  int status;
+
+  LOCK (workers);
+  for (index = 0; index < worker_count; index++)
+    if (pthread_equal (worker_threads[index], pthread_self ()))
+      break;
+  status = index < worker_count;
+  UNLOCK (workers);
+  retvm_if (status, VCONF_ERROR, "Can't change the workers from a callback");
+  retvm_if (__sync_lock_test_and_set (&changing, 1), VCONF_ERROR,
+	    "The workers are being changed");
+
+  _workers_stop_ ();
+  status = VCONF_OK;
+  if (count != 0)
+    {
+      threads = calloc (count, sizeof *threads);
+      if (threads == NULL)
+	{
+	  ERR ("Allocation of the workers failed");
+	  status = VCONF_ERROR;
+	}
+      else
+	{
+	  for (index = 0; index < count; index++)
+	    if (pthread_create (&threads[index], NULL, _worker_main_, NULL))
+	      break;
+	  LOCK (workers);
+	  worker_threads = threads;
+	  worker_count = index;
+	  workers_alive = index;
+	  UNLOCK (workers);
+	  if (index < count)
+	    {
+	      ERR ("Creation of the workers failed");
+	      _workers_stop_ ();
+	      status = VCONF_ERROR;
+	    }
+	}
+    }
+  __sync_lock_release (&changing);
+  return status;
+#else
+  retvm_if (count != 0, VCONF_ERROR, "Workers need multithreading");
+  return VCONF_OK;
+#endif
+}
+
+int
+vconf_set_main_context (struct _GMainContext *context)
+{
+#if !defined(NO_GLIB)
+  GSource *timer;
+  unsigned idle;
+  struct loop *loop;
+  struct event *events, *event;
+
+  events = NULL;
+  LOCK (notify);
+  if (context != glib_context)
+    {
+      if (context != NULL)
+	g_main_context_ref (context);
+
+      /*
+       * the events queued for the previous context go to the new one,
+       * or are run below without main context 
+       */
+      loop = context != NULL ? _loop_new_ (context) : NULL;
+      loop = __atomic_exchange_n (&glib_loop, loop, __ATOMIC_ACQ_REL);
+#if !defined(NO_MULTITHREADING)
+      while (__atomic_load_n (&glib_loop_posting, __ATOMIC_ACQUIRE) != 0)
+	sched_yield ();
+#endif
+      if (loop != NULL)
+	{
+	  events = _event_take_ (&loop->queue);
+	  g_source_destroy (&loop->source);
+	  g_source_unref (&loop->source);
+	}
+      if (events != NULL && glib_loop != NULL)
+	{
+	  for (; events != NULL; events = event)
+	    {
+	      event = events->next;
+	      _event_push_ (&glib_loop->queue, events);
+	    }
+	  g_main_context_wakeup (glib_loop->context);
+	}
+
+      /*
+       * the idle timer moves to the new context 
+       */
+      LOCK (buxton);
+      timer = glib_idle_timer == 0 ? NULL
+	: g_main_context_find_source_by_id (glib_context, glib_idle_timer);
+      if (timer != NULL)
+	g_source_destroy (timer);
+      if (glib_context != NULL)
+	g_main_context_unref (glib_context);
+      glib_context = context;
+      if (glib_idle_timer != 0)
+	{
+	  glib_idle_timer = 0;
+	  idle = _idle_time_ ();
+	  _arm_idle_timer_ (idle < connection_idle_period ?
+			    connection_idle_period - idle : 0);
+	}
+      UNLOCK (buxton);
+
+      if (glib_source != NULL || glib_timer_source != NULL)
+	{
+	  _glib_stop_watch_ ();
+	  _glib_start_watch_ ();
+	}
+    }
+  UNLOCK (notify);
+  _loop_run_ (events);
+  return VCONF_OK;
+#else
+  retvm_if (context != NULL, VCONF_ERROR, "Main contexts need glib");
+  return VCONF_OK;
+#endif
+}
+
+int
+vconf_get_stat (vconf_stat_t stat, unsigned long *value)
+{
+  retvm_if (value == NULL, VCONF_ERROR, "Invalid argument: value is NULL");
+
+  switch (stat)
+    {
+    case VCONF_STAT_CACHE_HITS:
+      *value = stat_cache_hits;
+      break;
+    case VCONF_STAT_CACHE_MISSES:
+      *value = stat_cache_misses;
+      break;
+    case VCONF_STAT_RECONNECTS:
+      *value = stat_reconnects;
+      break;
+    case VCONF_STAT_KEYS_CREATED:
+      *value = stat_keys_created;
+      break;
+    case VCONF_STAT_REQUESTS:
+      *value = stat_requests;
+      break;
+    case VCONF_STAT_POLLS:
+      *value = stat_polls;
+      break;
+    case VCONF_STAT_WAKEUPS:
+      *value = stat_wakeups;
+      break;
+    case VCONF_STAT_RESPONSES:
+      *value = stat_responses;
+      break;
+    default:
+      ERR ("Invalid argument: bad stat value");
+      return VCONF_ERROR;
+    }
+  return VCONF_OK;
 }